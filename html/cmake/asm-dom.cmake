@@ -24,6 +24,6 @@ if(NOT asm-dom_POPULATED)
     ${CMAKE_BINARY_DIR}/asm-dom.js
   )
 
-  string(APPEND CMAKE_CXX_FLAGS " -s EXTRA_EXPORTED_RUNTIME_METHODS=['UTF8ToString']")
+  string(APPEND CMAKE_CXX_FLAGS " -s EXTRA_EXPORTED_RUNTIME_METHODS=['UTF8ToString','stringToUTF8','lengthBytesUTF8']")
   string(APPEND CMAKE_CXX_FLAGS " -s WASM=1 --bind")
 endif()
@@ -0,0 +1,19 @@
+include(FetchContent)
+
+message(STATUS "Fetching brotli")
+
+FetchContent_Declare(brotli
+  GIT_REPOSITORY
+  https://github.com/google/brotli
+  GIT_TAG v1.1.0
+  GIT_SHALLOW TRUE)
+
+# Brotli is C, so it only sees the flags that were set through
+# add_compile_options() (not CMAKE_CXX_FLAGS) before this point. (In
+# particular, it must be built with -pthread for pthread builds.)
+
+# Only the decoder library is needed.
+set(BROTLI_DISABLE_TESTS ON CACHE BOOL "" FORCE)
+set(BROTLI_BUILD_TOOLS OFF CACHE BOOL "" FORCE)
+
+FetchContent_MakeAvailable(brotli)
@@ -2,6 +2,7 @@
 #include <alia/html/document.hpp>
 #include <alia/html/dom.hpp>
 #include <alia/html/fetch.hpp>
+#include <alia/html/fetch_json.hpp>
 #include <alia/html/routing.hpp>
 #include <alia/html/storage.hpp>
 #include <alia/html/system.hpp>
@@ -50,12 +51,12 @@ fetch_country_name(html::context ctx, readable<std::string> country_code)
 {
     auto request = apply(ctx, make_country_request, country_code);
 
-    // html::fetch() does the brunt of the work. It takes care of detecting
-    // when the input request changes, issuing the new request, and presenting
-    // the response (when it arrives) as its output.
-    auto response = html::fetch(ctx, request);
-
-    return apply(ctx, parse_country_response, response);
+    // html::fetch_decoded() does the brunt of the work. It takes care of
+    // detecting when the input request changes, issuing the new request, and
+    // presenting the parsed response (when it arrives) as its output. The
+    // parsing happens in the background, so it doesn't hold up the UI.
+    return html::fetch_decoded<std::optional<std::string>>(
+        ctx, request, parse_country_response);
 }
 
 // And here's the UI for interacting with it.
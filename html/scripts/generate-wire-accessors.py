@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+# This generates C++ readers and builders for the tables in a wire format
+# schema. (See src/alia/html/wire.hpp for a description of the format.)
+#
+# usage: generate-wire-accessors.py SCHEMA OUTPUT_HEADER
+import os
+import re
+import sys
+
+scalar_types = {
+    'bool': 'bool',
+    'int8': 'std::int8_t',
+    'int16': 'std::int16_t',
+    'int32': 'std::int32_t',
+    'int64': 'std::int64_t',
+    'uint8': 'std::uint8_t',
+    'uint16': 'std::uint16_t',
+    'uint32': 'std::uint32_t',
+    'uint64': 'std::uint64_t',
+    'float32': 'float',
+    'float64': 'double',
+}
+
+table_pattern = re.compile(r'table\s+(\w+)\s*\{([^}]*)\}')
+field_pattern = re.compile(
+    r'(\w+)\s*:\s*(\[\s*\w+\s*\]|\w+)\s*(?:=\s*([^;]+?))?\s*$')
+
+
+def fail(message):
+    sys.stderr.write('error: %s\n' % message)
+    sys.exit(1)
+
+
+def parse_schema(text):
+    text = re.sub(r'//[^\n]*', '', text)
+    tables = []
+    end = 0
+    for match in table_pattern.finditer(text):
+        if text[end:match.start()].strip():
+            fail('unexpected text: %s' % text[end:match.start()].strip())
+        end = match.end()
+        fields = []
+        for declaration in match.group(2).split(';'):
+            declaration = declaration.strip()
+            if not declaration:
+                continue
+            field = field_pattern.match(declaration)
+            if not field:
+                fail('invalid field: %s' % declaration)
+            name, type, default = field.groups()
+            fields.append((name, type.replace(' ', ''), default))
+        tables.append((match.group(1), fields))
+    if text[end:].strip():
+        fail('unexpected text: %s' % text[end:].strip())
+
+    table_names = set(name for name, _ in tables)
+    for table, fields in tables:
+        for name, type, default in fields:
+            element = type.strip('[]')
+            if element not in scalar_types and element != 'string' \
+                    and element not in table_names:
+                fail('%s.%s: unknown type: %s' % (table, name, element))
+            if default is not None and type not in scalar_types:
+                fail('%s.%s: only scalars can have defaults' % (table, name))
+    return tables
+
+
+def element_reader_type(element):
+    if element in scalar_types:
+        return scalar_types[element]
+    if element == 'string':
+        return 'std::string_view'
+    return element + '_reader'
+
+
+def generate_reader(table, fields):
+    declarations = []
+    definitions = []
+    for index, (name, type, default) in enumerate(fields):
+        if type.startswith('['):
+            element = element_reader_type(type[1:-1])
+            result = 'alia::html::wire_vector<%s>' % element
+            body = 'return read_vector<%s>(%d);' % (element, index)
+        elif type in scalar_types:
+            result = scalar_types[type]
+            if default is not None:
+                body = 'return read_scalar<%s>(%d, %s);' % (
+                    result, index, default)
+            else:
+                body = 'return read_scalar<%s>(%d);' % (result, index)
+        elif type == 'string':
+            result = 'std::string_view'
+            body = 'return read_string(%d);' % index
+        else:
+            result = type + '_reader'
+            body = 'return read_table<%s>(%d);' % (result, index)
+        declarations.append(
+            '    %s\n'
+            '    %s() const;\n' % (result, name))
+        definitions.append(
+            'inline %s\n'
+            '%s_reader::%s() const\n'
+            '{\n'
+            '    %s\n'
+            '}\n' % (result, table, name, body))
+    struct = (
+        'struct %s_reader : alia::html::wire_table\n'
+        '{\n'
+        '    using wire_table::wire_table;\n' % table)
+    if declarations:
+        struct += '\n' + '\n'.join(declarations)
+    struct += '};\n'
+    return struct, definitions
+
+
+def generate_builder(table, fields):
+    # Fields with defaults are initialized to them, so that setting a field
+    # is always optional.
+    defaults = ''.join(
+        '        builder.set_scalar<%s>(table_, %d, %s);\n' % (
+            scalar_types[type], index, default)
+        for index, (_, type, default) in enumerate(fields)
+        if default is not None)
+    setters = []
+    for index, (name, type, _) in enumerate(fields):
+        if type.startswith('['):
+            element = type[1:-1]
+            if element in scalar_types:
+                parameter = 'std::vector<%s> const&' % scalar_types[element]
+                call = 'set_vector(table_, %d, value)' % index
+            elif element == 'string':
+                parameter = 'std::vector<std::string> const&'
+                call = 'set_string_vector(table_, %d, value)' % index
+            else:
+                # Nested tables are built first and passed by offset.
+                parameter = 'std::vector<std::uint32_t> const&'
+                call = 'set_table_vector(table_, %d, value)' % index
+        elif type in scalar_types:
+            parameter = scalar_types[type]
+            call = 'set_scalar<%s>(table_, %d, value)' % (parameter, index)
+        elif type == 'string':
+            parameter = 'std::string_view'
+            call = 'set_string(table_, %d, value)' % index
+        else:
+            parameter = 'std::uint32_t'
+            call = 'set_table(table_, %d, value)' % index
+        setters.append(
+            '    %s_builder&\n'
+            '    set_%s(%s value)\n'
+            '    {\n'
+            '        builder_->%s;\n'
+            '        return *this;\n'
+            '    }\n' % (table, name, parameter, call))
+    return (
+        'struct %(table)s_builder\n'
+        '{\n'
+        '    explicit %(table)s_builder(alia::html::wire_builder& builder)\n'
+        '        : builder_(&builder),\n'
+        '          table_(builder.add_table(%(count)d))\n'
+        '    {\n'
+        '%(defaults)s'
+        '    }\n'
+        '\n'
+        '    // the offset of the table within the message\n'
+        '    std::uint32_t\n'
+        '    offset() const\n'
+        '    {\n'
+        '        return table_;\n'
+        '    }\n'
+        '\n'
+        '%(setters)s'
+        '\n'
+        ' private:\n'
+        '    alia::html::wire_builder* builder_;\n'
+        '    std::uint32_t table_;\n'
+        '};\n') % {
+            'table': table,
+            'count': len(fields),
+            'defaults': defaults,
+            'setters': '\n'.join(setters)}
+
+
+def generate_header(tables, schema_path, header_path):
+    guard = re.sub(r'\W', '_', os.path.basename(header_path)).upper()
+    sections = [
+        '// This file was generated by generate-wire-accessors.py from %s.\n'
+        "// Don't edit it directly.\n" % os.path.basename(schema_path),
+        '#ifndef %s\n#define %s\n' % (guard, guard),
+        '#include <alia/html/wire.hpp>\n',
+        ''.join('struct %s_reader;\n' % table for table, _ in tables)]
+    definitions = []
+    for table, fields in tables:
+        struct, table_definitions = generate_reader(table, fields)
+        sections.append(struct)
+        sections.append(generate_builder(table, fields))
+        definitions += table_definitions
+    # The accessors are defined after all the readers so that tables can
+    # refer to tables that are defined later in the schema.
+    sections += definitions
+    sections.append('#endif\n')
+    return '\n'.join(sections)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        fail('usage: %s SCHEMA OUTPUT_HEADER' % sys.argv[0])
+    with open(sys.argv[1]) as schema:
+        tables = parse_schema(schema.read())
+    with open(sys.argv[2], 'w') as header:
+        header.write(generate_header(tables, sys.argv[1], sys.argv[2]))
@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+# This serves the current directory like run-web-server.py, but it also
+# honors HTTP Range requests, so it can stand in for the servers that
+# range_reader talks to.
+import http.server
+import os
+import re
+import sys
+
+port = int(sys.argv[1]) if len(sys.argv) > 1 else 8003
+
+
+class RangeRequestHandler(http.server.SimpleHTTPRequestHandler):
+    extensions_map = dict(
+        http.server.SimpleHTTPRequestHandler.extensions_map,
+        **{'.wasm': 'application/wasm'})
+
+    def send_head(self):
+        range_header = self.headers.get('Range')
+        match = range_header and re.match(r'bytes=(\d*)-(\d*)$', range_header)
+        if not match:
+            return super().send_head()
+
+        path = self.translate_path(self.path)
+        if not os.path.isfile(path):
+            self.send_error(404, "File not found")
+            return None
+        size = os.path.getsize(path)
+
+        first, last = match.groups()
+        if first:
+            first = int(first)
+            if last and int(last) < first:
+                return self.send_unsatisfiable(size)
+            last = min(int(last), size - 1) if last else size - 1
+        elif last and int(last) > 0:
+            # a suffix range, i.e., the last N bytes
+            first = max(size - int(last), 0)
+            last = size - 1
+        else:
+            # 'bytes=-' or an empty suffix
+            return self.send_unsatisfiable(size)
+        if first >= size:
+            return self.send_unsatisfiable(size)
+
+        f = open(path, 'rb')
+        f.seek(first)
+        self.range_remaining = last - first + 1
+        self.send_response(206)
+        self.send_header('Content-Type', self.guess_type(path))
+        self.send_header('Accept-Ranges', 'bytes')
+        self.send_header(
+            'Content-Range', 'bytes %d-%d/%d' % (first, last, size))
+        self.send_header('Content-Length', str(self.range_remaining))
+        self.end_headers()
+        return f
+
+    def send_unsatisfiable(self, size):
+        self.send_response(416)
+        self.send_header('Content-Range', 'bytes */%d' % size)
+        self.send_header('Content-Length', '0')
+        self.end_headers()
+        return None
+
+    def copyfile(self, source, outputfile):
+        remaining = getattr(self, 'range_remaining', None)
+        if remaining is None:
+            return super().copyfile(source, outputfile)
+        self.range_remaining = None
+        while remaining > 0:
+            chunk = source.read(min(remaining, 64 * 1024))
+            if not chunk:
+                break
+            outputfile.write(chunk)
+            remaining -= len(chunk)
+
+
+print("Running on port %d" % port)
+http.server.HTTPServer(('localhost', port), RangeRequestHandler).serve_forever()
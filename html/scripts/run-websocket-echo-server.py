@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+# This runs a minimal WebSocket server that echoes every message back to its
+# sender (as the same kind of frame), so it can stand in for real servers
+# when testing html::websocket(). It only needs the standard library.
+#
+# usage: run-websocket-echo-server.py [PORT]
+#
+# If a client sends the text message 'burst N', the server replies with N
+# numbered text messages in a row, which is handy for checking how bursts are
+# coalesced.
+import base64
+import hashlib
+import socketserver
+import struct
+import sys
+
+port = int(sys.argv[1]) if len(sys.argv) > 1 else 8004
+
+GUID = '258EAFA5-E914-47DA-95CA-C5AB0DC85B11'
+
+OP_CONTINUATION = 0x0
+OP_TEXT = 0x1
+OP_BINARY = 0x2
+OP_CLOSE = 0x8
+OP_PING = 0x9
+OP_PONG = 0xa
+
+
+class EchoHandler(socketserver.StreamRequestHandler):
+    def handle(self):
+        if not self.handshake():
+            return
+        message_opcode = None
+        fragments = []
+        while True:
+            frame = self.read_frame()
+            if frame is None:
+                return
+            fin, opcode, payload = frame
+            if opcode == OP_CLOSE:
+                # Echo the close code (if any) and hang up.
+                self.send_frame(OP_CLOSE, payload[:2])
+                return
+            if opcode == OP_PING:
+                self.send_frame(OP_PONG, payload)
+                continue
+            if opcode == OP_PONG:
+                continue
+            if opcode != OP_CONTINUATION:
+                message_opcode = opcode
+                fragments = []
+            fragments.append(payload)
+            if fin:
+                self.handle_message(message_opcode, b''.join(fragments))
+
+    def handle_message(self, opcode, message):
+        if opcode == OP_TEXT and message.startswith(b'burst '):
+            try:
+                count = int(message[6:])
+            except ValueError:
+                count = 0
+            for i in range(count):
+                self.send_frame(OP_TEXT, str(i).encode())
+            return
+        self.send_frame(opcode, message)
+
+    def handshake(self):
+        request_line = self.rfile.readline()
+        if not request_line.startswith(b'GET '):
+            return False
+        headers = {}
+        while True:
+            line = self.rfile.readline().decode('latin-1').strip()
+            if not line:
+                break
+            name, _, value = line.partition(':')
+            headers[name.strip().lower()] = value.strip()
+        key = headers.get('sec-websocket-key')
+        if not key or 'websocket' not in headers.get('upgrade', '').lower():
+            self.wfile.write(
+                b'HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n')
+            return False
+        accept = base64.b64encode(
+            hashlib.sha1((key + GUID).encode()).digest()).decode()
+        response = [
+            'HTTP/1.1 101 Switching Protocols',
+            'Upgrade: websocket',
+            'Connection: Upgrade',
+            'Sec-WebSocket-Accept: ' + accept]
+        # Accept the first protocol that the client offers (if any).
+        protocols = headers.get('sec-websocket-protocol')
+        if protocols:
+            response.append(
+                'Sec-WebSocket-Protocol: ' + protocols.split(',')[0].strip())
+        self.wfile.write(('\r\n'.join(response) + '\r\n\r\n').encode())
+        return True
+
+    def read_exactly(self, size):
+        data = self.rfile.read(size)
+        return data if len(data) == size else None
+
+    def read_frame(self):
+        header = self.read_exactly(2)
+        if header is None:
+            return None
+        fin = bool(header[0] & 0x80)
+        opcode = header[0] & 0x0f
+        masked = bool(header[1] & 0x80)
+        size = header[1] & 0x7f
+        if size == 126:
+            extended = self.read_exactly(2)
+            if extended is None:
+                return None
+            size = struct.unpack('!H', extended)[0]
+        elif size == 127:
+            extended = self.read_exactly(8)
+            if extended is None:
+                return None
+            size = struct.unpack('!Q', extended)[0]
+        mask = self.read_exactly(4) if masked else b'\0\0\0\0'
+        payload = self.read_exactly(size) if size else b''
+        if mask is None or payload is None:
+            return None
+        if masked:
+            payload = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+        return fin, opcode, payload
+
+    def send_frame(self, opcode, payload):
+        header = bytes([0x80 | opcode])
+        size = len(payload)
+        if size < 126:
+            header += bytes([size])
+        elif size < 0x10000:
+            header += bytes([126]) + struct.pack('!H', size)
+        else:
+            header += bytes([127]) + struct.pack('!Q', size)
+        self.wfile.write(header + payload)
+        self.wfile.flush()
+
+
+class EchoServer(socketserver.ThreadingTCPServer):
+    allow_reuse_address = True
+    daemon_threads = True
+
+
+print("Running on port %d" % port)
+EchoServer(('localhost', port), EchoHandler).serve_forever()
@@ -0,0 +1,472 @@
+#include <alia/html/animation.hpp>
+
+#include <emscripten/emscripten.h>
+#include <emscripten/html5.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace alia { namespace html {
+
+// EASING CURVES
+
+static double
+eval_bezier(double p1, double p2, double t)
+{
+    // This is the 1D cubic Bezier with endpoints at 0 and 1.
+    double u = 1 - t;
+    return 3 * u * u * t * p1 + 3 * u * t * t * p2 + t * t * t;
+}
+
+static double
+eval_bezier_derivative(double p1, double p2, double t)
+{
+    double u = 1 - t;
+    return 3 * u * u * p1 + 6 * u * t * (p2 - p1) + 3 * t * t * (1 - p2);
+}
+
+double
+eval_curve(easing_curve const& curve, double x)
+{
+    if (x <= 0)
+        return 0;
+    if (x >= 1)
+        return 1;
+
+    // Solve for the curve parameter that gives us 'x'. Newton's method
+    // usually converges quickly. If it doesn't, fall back to bisection.
+    double epsilon = 1e-6;
+    double t = x;
+    for (int i = 0; i != 8; ++i)
+    {
+        double error = eval_bezier(curve.x1, curve.x2, t) - x;
+        if (std::fabs(error) < epsilon)
+            return eval_bezier(curve.y1, curve.y2, t);
+        double slope = eval_bezier_derivative(curve.x1, curve.x2, t);
+        if (std::fabs(slope) < 1e-6)
+            break;
+        t -= error / slope;
+    }
+    double lower = 0, upper = 1;
+    t = x;
+    while (upper - lower > epsilon)
+    {
+        if (eval_bezier(curve.x1, curve.x2, t) < x)
+            lower = t;
+        else
+            upper = t;
+        t = (lower + upper) / 2;
+    }
+    return eval_bezier(curve.y1, curve.y2, t);
+}
+
+// SPRINGS
+
+static double
+eval_spring_displacement(
+    spring_parameters const& spring, double d0, double v0, double t)
+{
+    // This is the analytic solution for a damped harmonic oscillator.
+    double w0 = std::sqrt(spring.stiffness / spring.mass);
+    double zeta
+        = spring.damping / (2 * std::sqrt(spring.stiffness * spring.mass));
+    if (zeta < 1)
+    {
+        double wd = w0 * std::sqrt(1 - zeta * zeta);
+        return std::exp(-zeta * w0 * t)
+               * (d0 * std::cos(wd * t)
+                  + (v0 + zeta * w0 * d0) / wd * std::sin(wd * t));
+    }
+    else if (zeta == 1)
+    {
+        return std::exp(-w0 * t) * (d0 + (v0 + w0 * d0) * t);
+    }
+    else
+    {
+        double s = std::sqrt(zeta * zeta - 1);
+        double r1 = -w0 * (zeta - s);
+        double r2 = -w0 * (zeta + s);
+        double a = (v0 - r2 * d0) / (r1 - r2);
+        double b = d0 - a;
+        return a * std::exp(r1 * t) + b * std::exp(r2 * t);
+    }
+}
+
+spring_state
+eval_spring(
+    spring_parameters const& spring,
+    double from,
+    double to,
+    double initial_velocity,
+    double t)
+{
+    double d0 = from - to;
+    double h = 0.0005;
+    double d = eval_spring_displacement(spring, d0, initial_velocity, t);
+    if (t < h)
+        return spring_state{to + d, initial_velocity};
+    double velocity
+        = (eval_spring_displacement(spring, d0, initial_velocity, t + h)
+           - eval_spring_displacement(spring, d0, initial_velocity, t - h))
+          / (2 * h);
+    return spring_state{to + d, velocity};
+}
+
+static bool
+spring_at_rest(
+    spring_parameters const& spring, spring_state const& state, double to)
+{
+    return std::fabs(state.position - to) < spring.rest_threshold
+           && std::fabs(state.velocity) < spring.rest_threshold;
+}
+
+double
+spring_settling_time(
+    spring_parameters const& spring,
+    double from,
+    double to,
+    double initial_velocity)
+{
+    double const step = 1. / 60;
+    double const max_time = 10;
+    double t = 0;
+    while (t < max_time)
+    {
+        t += step;
+        auto state = eval_spring(spring, from, to, initial_velocity, t);
+        if (spring_at_rest(spring, state, to))
+            break;
+    }
+    return t;
+}
+
+// ANIMATED VALUES
+
+namespace detail {
+
+struct animated_value_data;
+
+static void
+stop_animation(animated_value_data& data);
+
+struct animated_value_data : noncopyable
+{
+    ~animated_value_data()
+    {
+        stop_animation(*this);
+    }
+
+    captured_id value_id;
+
+    int asmdom_id = 0;
+    animation_target target;
+    std::string name, prefix, suffix;
+    value_transition transition;
+    // Should this be handed off to the Web Animations API?
+    bool composited = false;
+
+    bool has_value = false;
+    bool animating = false;
+    double from = 0, to = 0, initial_velocity = 0;
+    double start_time = 0;
+    // for curve transitions, the duration in milliseconds; for springs, the
+    // settling time
+    double duration = 0;
+};
+
+struct animation_sample
+{
+    double value;
+    double velocity;
+    bool done;
+};
+
+static animation_sample
+sample_animation(animated_value_data const& data, double now)
+{
+    if (!data.animating)
+        return animation_sample{data.to, 0, true};
+    double elapsed = (std::max)(0., now - data.start_time);
+    if (elapsed >= data.duration)
+        return animation_sample{data.to, 0, true};
+    if (data.transition.is_spring)
+    {
+        auto state = eval_spring(
+            data.transition.spring,
+            data.from,
+            data.to,
+            data.initial_velocity,
+            elapsed / 1000);
+        return animation_sample{state.position, state.velocity, false};
+    }
+    else
+    {
+        double x = elapsed / data.duration;
+        double y = eval_curve(data.transition.curve, x);
+        // Estimate the velocity so that an interrupting spring can pick it
+        // up. (Curves themselves always start from rest.)
+        double h = 0.001;
+        double dy = eval_curve(data.transition.curve, (std::min)(1., x + h))
+                    - y;
+        double velocity = (data.to - data.from) * dy / h / data.duration
+                          * 1000;
+        return animation_sample{
+            data.from + (data.to - data.from) * y, velocity, false};
+    }
+}
+
+static std::string
+format_value(animated_value_data const& data, double value)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%g", value);
+    return data.prefix + buffer + data.suffix;
+}
+
+static void
+write_value(animated_value_data const& data, double value)
+{
+    switch (data.target)
+    {
+        case animation_target::STYLE:
+            EM_ASM(
+                {
+                    Module['nodes'][$0].style.setProperty(
+                        Module['UTF8ToString']($1),
+                        Module['UTF8ToString']($2));
+                },
+                data.asmdom_id,
+                data.name.c_str(),
+                format_value(data, value).c_str());
+            break;
+        case animation_target::PROPERTY:
+            asmdom::direct::setProperty(
+                data.asmdom_id, data.name.c_str(), emscripten::val(value));
+            break;
+    }
+}
+
+// All animations that aren't composited are driven by this frame loop.
+
+static std::vector<animated_value_data*> active_animations;
+static bool frame_loop_running = false;
+
+static EM_BOOL
+animation_frame(double now, void*)
+{
+    // Note that the list can't change while we're iterating over it since
+    // writing values doesn't invoke any application code.
+    auto i = active_animations.begin();
+    while (i != active_animations.end())
+    {
+        auto& data = **i;
+        auto sample = sample_animation(data, now);
+        write_value(data, sample.value);
+        if (sample.done)
+        {
+            data.animating = false;
+            i = active_animations.erase(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    frame_loop_running = !active_animations.empty();
+    return frame_loop_running ? EM_TRUE : EM_FALSE;
+}
+
+static void
+start_frame_driven_animation(animated_value_data& data)
+{
+    if (std::find(
+            active_animations.begin(), active_animations.end(), &data)
+        == active_animations.end())
+    {
+        active_animations.push_back(&data);
+    }
+    if (!frame_loop_running)
+    {
+        emscripten_request_animation_frame_loop(animation_frame, nullptr);
+        frame_loop_running = true;
+    }
+}
+
+static void
+start_composited_animation(animated_value_data& data)
+{
+    // Sample the animation into keyframes. Curves can be described to the
+    // browser directly, but springs have to be sampled.
+    std::vector<double> keyframes;
+    std::string easing = "linear";
+    if (data.transition.is_spring)
+    {
+        double const frame = 1000. / 60;
+        for (double t = 0; t < data.duration; t += frame)
+        {
+            keyframes.push_back(
+                sample_animation(data, data.start_time + t).value);
+        }
+        keyframes.push_back(data.to);
+    }
+    else
+    {
+        keyframes.push_back(data.from);
+        keyframes.push_back(data.to);
+        auto const& curve = data.transition.curve;
+        char buffer[96];
+        std::snprintf(
+            buffer,
+            sizeof(buffer),
+            "cubic-bezier(%g, %g, %g, %g)",
+            curve.x1,
+            curve.y1,
+            curve.x2,
+            curve.y2);
+        easing = buffer;
+    }
+
+    // The final value is written to the inline style first, so that it takes
+    // effect once the animation ends (or if the browser doesn't support Web
+    // Animations at all).
+    write_value(data, data.to);
+
+    EM_ASM(
+        {
+            var node = Module['nodes'][$0];
+            if (!node.animate)
+                return;
+            var property = Module['UTF8ToString']($1);
+            var prefix = Module['UTF8ToString']($2);
+            var suffix = Module['UTF8ToString']($3);
+            var values = HEAPF64.subarray($4 >> 3, ($4 >> 3) + $5);
+            var keyframes = [];
+            for (var i = 0; i < values.length; ++i)
+            {
+                var keyframe = {};
+                keyframe[property] = prefix + values[i] + suffix;
+                keyframes.push(keyframe);
+            }
+            if (!('aliaAnimations' in Module))
+                Module['aliaAnimations'] = {};
+            var animations = Module['aliaAnimations'];
+            if (animations[$6])
+                animations[$6].cancel();
+            animations[$6] = node.animate(keyframes, {
+                duration : $7,
+                easing : Module['UTF8ToString']($8)
+            });
+        },
+        data.asmdom_id,
+        data.name.c_str(),
+        data.prefix.c_str(),
+        data.suffix.c_str(),
+        keyframes.data(),
+        int(keyframes.size()),
+        reinterpret_cast<std::uintptr_t>(&data),
+        data.duration,
+        easing.c_str());
+}
+
+static void
+stop_animation(animated_value_data& data)
+{
+    if (data.composited)
+    {
+        EM_ASM(
+            {
+                if ('aliaAnimations' in Module)
+                {
+                    var animations = Module['aliaAnimations'];
+                    if (animations[$0])
+                    {
+                        animations[$0].cancel();
+                        delete animations[$0];
+                    }
+                }
+            },
+            reinterpret_cast<std::uintptr_t>(&data));
+    }
+    else
+    {
+        active_animations.erase(
+            std::remove(
+                active_animations.begin(), active_animations.end(), &data),
+            active_animations.end());
+    }
+    data.animating = false;
+}
+
+static void
+retarget_animation(animated_value_data& data, double new_value)
+{
+    if (!data.has_value)
+    {
+        // There's nothing to animate from, so just jump to the new value.
+        data.has_value = true;
+        data.to = new_value;
+        write_value(data, new_value);
+        return;
+    }
+
+    double now = emscripten_get_now();
+    auto current = sample_animation(data, now);
+
+    data.from = current.value;
+    data.to = new_value;
+    data.initial_velocity = current.velocity;
+    data.start_time = now;
+    data.animating = true;
+    data.duration = data.transition.is_spring
+                        ? spring_settling_time(
+                              data.transition.spring,
+                              data.from,
+                              data.to,
+                              data.initial_velocity)
+                              * 1000
+                        : double(data.transition.duration);
+
+    if (data.composited)
+        start_composited_animation(data);
+    else
+        start_frame_driven_animation(data);
+}
+
+void
+animate_value(
+    html::context ctx,
+    element_object& object,
+    animation_target target,
+    char const* name,
+    char const* function,
+    char const* unit,
+    readable<double> value,
+    value_transition const& transition)
+{
+    animated_value_data* data;
+    if (get_cached_data(ctx, &data))
+    {
+        data->target = target;
+        data->name = name;
+        data->prefix = function ? std::string(function) + "(" : "";
+        data->suffix = function ? std::string(unit) + ")" : unit;
+        data->composited
+            = target == animation_target::STYLE
+              && (data->name == "opacity" || data->name == "transform");
+    }
+    refresh_handler(ctx, [&](auto ctx) {
+        data->asmdom_id = object.asmdom_id;
+        data->transition = transition;
+        refresh_signal_view(
+            data->value_id,
+            value,
+            [&](double new_value) { retarget_animation(*data, new_value); },
+            [&]() {});
+    });
+}
+
+} // namespace detail
+
+}} // namespace alia::html
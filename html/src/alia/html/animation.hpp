@@ -0,0 +1,205 @@
+#ifndef ALIA_HTML_ANIMATION_HPP
+#define ALIA_HTML_ANIMATION_HPP
+
+#include <alia/html/context.hpp>
+#include <alia/html/dom.hpp>
+
+namespace alia { namespace html {
+
+// ANIMATION
+//
+// The following allows numeric styles and properties of elements to smoothly
+// transition to new values. Whenever the value of the input signal changes,
+// the style/property animates from its current (possibly mid-animation) value
+// to the new one.
+//
+// Animations don't require refreshes. Most are driven by a single
+// requestAnimationFrame loop that writes only to the animated nodes. The
+// 'opacity' and 'transform' styles are handed off to the Web Animations API
+// instead, so that the browser can run them on the compositor.
+//
+
+// EASING CURVES - These are CSS-style cubic Bezier curves.
+
+struct easing_curve
+{
+    double x1, y1, x2, y2;
+};
+
+namespace easing {
+
+static easing_curve const linear = {0, 0, 1, 1};
+static easing_curve const ease = {0.25, 0.1, 0.25, 1};
+static easing_curve const ease_in = {0.42, 0, 1, 1};
+static easing_curve const ease_out = {0, 0, 0.58, 1};
+static easing_curve const ease_in_out = {0.42, 0, 0.58, 1};
+
+} // namespace easing
+
+// Evaluate an easing curve at the given point in time (in the range [0, 1]).
+double
+eval_curve(easing_curve const& curve, double t);
+
+// SPRINGS - Spring transitions simulate a damped spring. Unlike curves, they
+// have no fixed duration and preserve velocity when interrupted.
+
+struct spring_parameters
+{
+    double stiffness = 170;
+    double damping = 26;
+    double mass = 1;
+    // The spring is considered at rest when both its displacement from the
+    // target and its velocity are below this threshold.
+    double rest_threshold = 0.01;
+};
+
+struct spring_state
+{
+    double position;
+    // velocity, in units per second
+    double velocity;
+};
+
+// Evaluate the state of a spring that was released at 'from' with the given
+// initial velocity and is pulling toward 'to'.
+spring_state
+eval_spring(
+    spring_parameters const& spring,
+    double from,
+    double to,
+    double initial_velocity,
+    double seconds);
+
+// Get the time (in seconds) that the given spring takes to come to rest.
+double
+spring_settling_time(
+    spring_parameters const& spring,
+    double from,
+    double to,
+    double initial_velocity);
+
+// TRANSITIONS
+
+struct value_transition
+{
+    bool is_spring = false;
+    // for curve transitions
+    millisecond_count duration = 250;
+    easing_curve curve = easing::ease;
+    // for spring transitions
+    spring_parameters spring;
+};
+
+inline value_transition
+curve_transition(
+    millisecond_count duration, easing_curve const& curve = easing::ease)
+{
+    value_transition transition;
+    transition.duration = duration;
+    transition.curve = curve;
+    return transition;
+}
+
+inline value_transition
+spring_transition(spring_parameters const& spring = spring_parameters())
+{
+    value_transition transition;
+    transition.is_spring = true;
+    transition.spring = spring;
+    return transition;
+}
+
+// ANIMATED STYLES AND PROPERTIES
+
+namespace detail {
+
+enum class animation_target
+{
+    STYLE,
+    PROPERTY
+};
+
+void
+animate_value(
+    html::context ctx,
+    element_object& object,
+    animation_target target,
+    char const* name,
+    // If this isn't null, the value is written as a CSS function call.
+    char const* function,
+    char const* unit,
+    readable<double> value,
+    value_transition const& transition);
+
+} // namespace detail
+
+// Animate a numeric style of an element.
+// 'unit' is appended to the value, e.g., animate_style(e, "left", x, "px").
+template<class Element>
+Element&
+animate_style(
+    Element& element,
+    char const* property,
+    readable<double> value,
+    char const* unit = "",
+    value_transition const& transition = value_transition())
+{
+    detail::animate_value(
+        element.context(),
+        element.node().object,
+        detail::animation_target::STYLE,
+        property,
+        nullptr,
+        unit,
+        value,
+        transition);
+    return element;
+}
+
+// Animate the 'transform' style of an element using a single transform
+// function, e.g., animate_transform(e, "translateX", x, "px").
+template<class Element>
+Element&
+animate_transform(
+    Element& element,
+    char const* function,
+    readable<double> value,
+    char const* unit = "",
+    value_transition const& transition = value_transition())
+{
+    detail::animate_value(
+        element.context(),
+        element.node().object,
+        detail::animation_target::STYLE,
+        "transform",
+        function,
+        unit,
+        value,
+        transition);
+    return element;
+}
+
+// Animate a numeric DOM property of an element (e.g., 'scrollTop').
+template<class Element>
+Element&
+animate_property(
+    Element& element,
+    char const* property,
+    readable<double> value,
+    value_transition const& transition = value_transition())
+{
+    detail::animate_value(
+        element.context(),
+        element.node().object,
+        detail::animation_target::PROPERTY,
+        property,
+        nullptr,
+        "",
+        value,
+        transition);
+    return element;
+}
+
+}} // namespace alia::html
+
+#endif
@@ -0,0 +1,138 @@
+#include <alia/html/bindings.hpp>
+
+#include <algorithm>
+
+namespace alia { namespace html {
+
+namespace detail {
+
+direct_binding::~direct_binding()
+{
+    this->detach();
+}
+
+void
+direct_binding::detach()
+{
+    if (this->source)
+    {
+        auto& bindings = this->source->bindings_;
+        bindings.erase(
+            std::remove(bindings.begin(), bindings.end(), this),
+            bindings.end());
+        this->source = nullptr;
+    }
+}
+
+void
+write_binding(direct_binding& binding)
+{
+    auto const& source = *binding.source;
+    if (source.has_value())
+    {
+        // Text nodes are written through their nodeValue property, which also
+        // takes care of converting numbers and such to text.
+        asmdom::direct::setProperty(
+            binding.asmdom_id,
+            binding.property.empty() ? "nodeValue" : binding.property.c_str(),
+            source.get());
+    }
+    else if (binding.property.empty())
+    {
+        asmdom::direct::setNodeValue(binding.asmdom_id, "");
+    }
+    else
+    {
+        asmdom::direct::removeProperty(
+            binding.asmdom_id, binding.property.c_str());
+    }
+    binding.written_version = source.version();
+}
+
+void
+refresh_binding(
+    direct_binding& binding,
+    binding_source& source,
+    int asmdom_id,
+    char const* property)
+{
+    if (binding.source != &source || binding.asmdom_id != asmdom_id)
+    {
+        binding.detach();
+        binding.source = &source;
+        binding.asmdom_id = asmdom_id;
+        binding.property = property ? property : "";
+        binding.written_version = 0;
+        source.bindings_.push_back(&binding);
+    }
+    if (binding.written_version != source.version())
+        write_binding(binding);
+}
+
+void
+bind_property(
+    html::context ctx,
+    element_object& object,
+    char const* name,
+    binding_source& source)
+{
+    auto& binding = get_cached_data<direct_binding>(ctx);
+    refresh_handler(ctx, [&](auto ctx) {
+        refresh_binding(binding, source, object.asmdom_id, name);
+    });
+}
+
+} // namespace detail
+
+binding_source::~binding_source()
+{
+    for (auto* binding : bindings_)
+        binding->source = nullptr;
+}
+
+void
+binding_source::set_val(emscripten::val value)
+{
+    value_ = std::move(value);
+    has_value_ = true;
+    ++version_;
+    this->write_all();
+}
+
+void
+binding_source::clear()
+{
+    value_ = emscripten::val::undefined();
+    has_value_ = false;
+    ++version_;
+    this->write_all();
+}
+
+void
+binding_source::write_all()
+{
+    for (auto* binding : bindings_)
+        detail::write_binding(*binding);
+}
+
+struct bound_text_data
+{
+    tree_node<element_object> node;
+    detail::direct_binding binding;
+};
+
+void
+bind_text(html::context ctx, binding_source& source)
+{
+    bound_text_data* data;
+    if (get_cached_data(ctx, &data))
+        create_as_text(data->node.object, "");
+    if (is_refresh_event(ctx))
+    {
+        refresh_tree_node(get<tree_traversal_tag>(ctx), data->node);
+        detail::refresh_binding(
+            data->binding, source, data->node.object.asmdom_id, nullptr);
+    }
+}
+
+}} // namespace alia::html
@@ -0,0 +1,146 @@
+#ifndef ALIA_HTML_BINDINGS_HPP
+#define ALIA_HTML_BINDINGS_HPP
+
+#include <string>
+#include <vector>
+
+#include <emscripten/val.h>
+
+#include <alia/html/context.hpp>
+#include <alia/html/dom.hpp>
+
+namespace alia { namespace html {
+
+// DIRECT BINDINGS
+//
+// Normally, getting a new value into the DOM requires a refresh, which
+// traverses the component tree to reach the call site that renders the value.
+// For rapidly changing values that are produced outside the normal dataflow
+// (e.g., 60 Hz telemetry), that's a lot of work to update one text node.
+//
+// A binding_source holds such a value. Text nodes and element properties can
+// be bound to a source, and setting the source writes the new value directly
+// to the bound nodes, without any traversal.
+//
+// Bindings are still declared through the normal refresh path, so they come
+// and go with the rest of the UI, and a refresh will also write the source's
+// current value if a binding is somehow behind. Each binding records the
+// version of the source that it last wrote, so neither path writes to the DOM
+// unnecessarily.
+//
+
+struct binding_source;
+
+namespace detail {
+
+struct direct_binding : noncopyable
+{
+    ~direct_binding();
+
+    // Detach the binding from its source (if any).
+    void
+    detach();
+
+    binding_source* source = nullptr;
+    int asmdom_id = 0;
+    // the property to write (or empty for the value of a text node)
+    std::string property;
+    // the version of the source that was last written to the DOM
+    unsigned written_version = 0;
+};
+
+void
+write_binding(direct_binding& binding);
+
+void
+refresh_binding(
+    direct_binding& binding,
+    binding_source& source,
+    int asmdom_id,
+    char const* property);
+
+void
+bind_property(
+    html::context ctx,
+    element_object& object,
+    char const* name,
+    binding_source& source);
+
+} // namespace detail
+
+struct binding_source : noncopyable
+{
+    ~binding_source();
+
+    // Set the value of the source, writing it to all bound nodes.
+    // 'value' can be anything that's convertible to an emscripten::val.
+    template<class Value>
+    void
+    set(Value const& value)
+    {
+        this->set_val(emscripten::val(value));
+    }
+
+    void
+    set_val(emscripten::val value);
+
+    // Clear the value of the source (and of all bound nodes).
+    void
+    clear();
+
+    bool
+    has_value() const
+    {
+        return has_value_;
+    }
+
+    emscripten::val const&
+    get() const
+    {
+        return value_;
+    }
+
+    unsigned
+    version() const
+    {
+        return version_;
+    }
+
+ private:
+    friend void
+    detail::refresh_binding(
+        detail::direct_binding& binding,
+        binding_source& source,
+        int asmdom_id,
+        char const* property);
+
+    friend struct detail::direct_binding;
+
+    void
+    write_all();
+
+    emscripten::val value_ = emscripten::val::undefined();
+    bool has_value_ = false;
+    // Versions start at 1 so that new bindings (which have written version
+    // 0) always get an initial write.
+    unsigned version_ = 1;
+    std::vector<detail::direct_binding*> bindings_;
+};
+
+// Do a text node whose value is bound to 'source'.
+void
+bind_text(html::context ctx, binding_source& source);
+
+// Bind a property of an element to 'source'.
+template<class Element>
+Element&
+bind_property(Element& element, char const* name, binding_source& source)
+{
+    detail::bind_property(
+        element.context(), element.node().object, name, source);
+    return element;
+}
+
+}} // namespace alia::html
+
+#endif
@@ -14,6 +14,13 @@ ALIA_DEFINE_TAGGED_TYPE(system_tag, system&)
 typedef extend_context_type_t<alia::context, tree_traversal_tag, system_tag>
     context;
 
+// Refresh an alia system in response to something that happened
+// asynchronously (e.g., a fetch completing). If the system belongs to an HTML
+// system whose document is hidden (see enable_visibility_monitoring()), the
+// refresh is deferred until the document is visible again.
+void
+refresh_system_when_visible(alia::system& sys);
+
 }} // namespace alia::html
 
 #endif
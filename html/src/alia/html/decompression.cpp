@@ -0,0 +1,455 @@
+#include <alia/html/decompression.hpp>
+
+#include <alia/html/worker_pool.hpp>
+
+#include <brotli/decode.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace alia { namespace html {
+
+namespace {
+
+// BUFFER POOL
+
+// the size of the chunks that a decompressor streams out
+std::size_t const chunk_size = 64 * 1024;
+
+// Buffers are only kept around up to a point, so that one huge payload
+// doesn't pin its buffer forever.
+std::size_t const max_pooled_buffers = 8;
+std::size_t const max_pooled_capacity = 16 * 1024 * 1024;
+
+struct pooled_buffer
+{
+    std::unique_ptr<char[]> data;
+    std::size_t capacity = 0;
+    std::size_t size = 0;
+};
+
+// Buffers are acquired on workers and released on the main thread, so the
+// pool needs a lock.
+struct buffer_pool
+{
+    std::mutex mutex;
+    std::vector<pooled_buffer> free_buffers;
+};
+
+buffer_pool the_pool;
+
+void
+reserve_buffer(pooled_buffer& buffer, std::size_t capacity)
+{
+    if (buffer.capacity >= capacity)
+        return;
+    std::unique_ptr<char[]> data(new char[capacity]);
+    if (buffer.size != 0)
+        std::memcpy(data.get(), buffer.data.get(), buffer.size);
+    buffer.data = std::move(data);
+    buffer.capacity = capacity;
+}
+
+pooled_buffer
+acquire_buffer(std::size_t capacity)
+{
+    pooled_buffer buffer;
+    {
+        std::lock_guard<std::mutex> lock(the_pool.mutex);
+        auto& free_buffers = the_pool.free_buffers;
+        if (!free_buffers.empty())
+        {
+            // Prefer the smallest buffer that's big enough. Otherwise, take
+            // the biggest one and grow it.
+            auto best = free_buffers.begin();
+            for (auto i = free_buffers.begin(); i != free_buffers.end(); ++i)
+            {
+                bool fits = i->capacity >= capacity;
+                bool best_fits = best->capacity >= capacity;
+                if (fits ? !best_fits || i->capacity < best->capacity
+                         : !best_fits && i->capacity > best->capacity)
+                {
+                    best = i;
+                }
+            }
+            buffer = std::move(*best);
+            free_buffers.erase(best);
+        }
+    }
+    buffer.size = 0;
+    reserve_buffer(buffer, capacity);
+    return buffer;
+}
+
+void
+release_buffer(pooled_buffer buffer)
+{
+    if (!buffer.data || buffer.capacity > max_pooled_capacity)
+        return;
+    std::lock_guard<std::mutex> lock(the_pool.mutex);
+    if (the_pool.free_buffers.size() < max_pooled_buffers)
+        the_pool.free_buffers.push_back(std::move(buffer));
+}
+
+// Make a blob out of a buffer. The buffer goes back to the pool when the
+// last copy of the blob is released.
+blob
+make_pooled_blob(pooled_buffer buffer)
+{
+    std::shared_ptr<pooled_buffer> owner(
+        new pooled_buffer(std::move(buffer)), [](pooled_buffer* buffer) {
+            release_buffer(std::move(*buffer));
+            delete buffer;
+        });
+    return blob{owner->data.get(), owner->size, owner};
+}
+
+// Does this look like the header of zlib-wrapped (rather than raw) deflate
+// data?
+bool
+is_zlib_header(unsigned char first, unsigned char second)
+{
+    return (first & 0x0f) == Z_DEFLATED && (first >> 4) <= 7
+           && ((first << 8) | second) % 31 == 0;
+}
+
+} // namespace
+
+// DECOMPRESSOR
+
+struct decompressor::impl
+{
+    compression_format format;
+    // If this is empty, output accumulates in the buffer instead.
+    output_handler output;
+    pooled_buffer buffer;
+
+    // Has the underlying decoder been initialized?
+    bool started = false;
+    bool finished = false;
+
+    // For DEFLATE, the first byte of the data, held until the second one
+    // arrives (since both are needed to tell what kind of data it is).
+    std::string header;
+
+    z_stream zlib = z_stream();
+    BrotliDecoderState* brotli = nullptr;
+
+    impl(compression_format format, output_handler output)
+        : format(format), output(std::move(output))
+    {
+    }
+
+    ~impl()
+    {
+        if (started)
+        {
+            if (format == compression_format::BROTLI)
+                BrotliDecoderDestroyInstance(brotli);
+            else
+                inflateEnd(&zlib);
+        }
+        release_buffer(std::move(buffer));
+    }
+
+    void
+    start(char const* data)
+    {
+        if (format == compression_format::BROTLI)
+        {
+            brotli = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+            if (!brotli)
+                throw std::bad_alloc();
+        }
+        else
+        {
+            int window_bits = MAX_WBITS;
+            if (format == compression_format::GZIP)
+                window_bits += 16;
+            else if (!is_zlib_header(
+                         static_cast<unsigned char>(data[0]),
+                         static_cast<unsigned char>(data[1])))
+                window_bits = -window_bits;
+            if (inflateInit2(&zlib, window_bits) != Z_OK)
+                throw exception("failed to initialize zlib");
+        }
+        started = true;
+    }
+
+    // Make sure there's room in the buffer for more output.
+    void
+    make_room()
+    {
+        if (buffer.size != buffer.capacity)
+            return;
+        if (output)
+            flush();
+        else
+            reserve_buffer(buffer, std::max(buffer.capacity * 2, chunk_size));
+    }
+
+    void
+    flush()
+    {
+        if (buffer.size != 0)
+        {
+            output(buffer.data.get(), buffer.size);
+            buffer.size = 0;
+        }
+    }
+
+    void
+    feed(char const* data, std::size_t size)
+    {
+        if (!started)
+        {
+            if (format == compression_format::DEFLATE)
+            {
+                if (header.size() + size < 2)
+                {
+                    header.append(data, size);
+                    return;
+                }
+                if (!header.empty())
+                {
+                    char first_two[2] = {header[0], data[0]};
+                    start(first_two);
+                    run(header.data(), header.size());
+                    header.clear();
+                }
+                else
+                {
+                    start(data);
+                }
+            }
+            else
+            {
+                if (size == 0)
+                    return;
+                start(data);
+            }
+        }
+        run(data, size);
+        if (output)
+            flush();
+    }
+
+    void
+    run(char const* data, std::size_t size)
+    {
+        if (format == compression_format::BROTLI)
+            run_brotli(data, size);
+        else
+            run_zlib(data, size);
+    }
+
+    void
+    run_zlib(char const* data, std::size_t size)
+    {
+        zlib.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        zlib.avail_in = uInt(size);
+        while (true)
+        {
+            if (finished)
+            {
+                if (zlib.avail_in == 0)
+                    break;
+                // gzip data can consist of several concatenated members.
+                if (format != compression_format::GZIP)
+                    throw exception("unexpected data after compressed data");
+                inflateReset(&zlib);
+                finished = false;
+            }
+            make_room();
+            zlib.next_out
+                = reinterpret_cast<Bytef*>(buffer.data.get() + buffer.size);
+            zlib.avail_out = uInt(buffer.capacity - buffer.size);
+            int result = inflate(&zlib, Z_NO_FLUSH);
+            buffer.size = buffer.capacity - zlib.avail_out;
+            if (result == Z_STREAM_END)
+            {
+                finished = true;
+            }
+            else if (result == Z_BUF_ERROR)
+            {
+                // There's always room for output, so this means that zlib
+                // needs more input.
+                break;
+            }
+            else if (result != Z_OK)
+            {
+                throw exception(
+                    std::string("invalid compressed data: ")
+                    + (zlib.msg ? zlib.msg : "zlib error"));
+            }
+            else if (zlib.avail_in == 0 && zlib.avail_out != 0)
+            {
+                break;
+            }
+        }
+    }
+
+    void
+    run_brotli(char const* data, std::size_t size)
+    {
+        auto const* next_in = reinterpret_cast<std::uint8_t const*>(data);
+        std::size_t available_in = size;
+        while (true)
+        {
+            if (finished)
+            {
+                if (available_in != 0)
+                    throw exception("unexpected data after compressed data");
+                break;
+            }
+            make_room();
+            auto* next_out = reinterpret_cast<std::uint8_t*>(
+                buffer.data.get() + buffer.size);
+            std::size_t available_out = buffer.capacity - buffer.size;
+            auto result = BrotliDecoderDecompressStream(
+                brotli,
+                &available_in,
+                &next_in,
+                &available_out,
+                &next_out,
+                nullptr);
+            buffer.size = buffer.capacity - available_out;
+            switch (result)
+            {
+                case BROTLI_DECODER_RESULT_ERROR:
+                    throw exception(
+                        std::string("invalid compressed data: ")
+                        + BrotliDecoderErrorString(
+                            BrotliDecoderGetErrorCode(brotli)));
+                case BROTLI_DECODER_RESULT_SUCCESS:
+                    finished = true;
+                    break;
+                case BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT:
+                    return;
+                case BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT:
+                    break;
+            }
+        }
+    }
+
+    void
+    finish()
+    {
+        if (!finished)
+            throw exception("compressed data is truncated");
+        if (output)
+            flush();
+    }
+};
+
+decompressor::decompressor(compression_format format, output_handler output)
+    : impl_(new impl(format, std::move(output)))
+{
+    impl_->buffer = acquire_buffer(chunk_size);
+}
+
+decompressor::decompressor(decompressor&& other) = default;
+
+decompressor&
+decompressor::operator=(decompressor&& other) = default;
+
+decompressor::~decompressor()
+{
+}
+
+void
+decompressor::feed(char const* data, std::size_t size)
+{
+    impl_->feed(data, size);
+}
+
+void
+decompressor::finish()
+{
+    impl_->finish();
+}
+
+bool
+decompressor::finished() const
+{
+    return impl_->finished;
+}
+
+blob
+decompress(compression_format format, blob const& input)
+{
+    // Guess the size of the output up front, to avoid regrowing the buffer.
+    // gzip data records it (modulo 2^32) at the end, but that comes from the
+    // input, which may be corrupt or truncated, so it's only trusted up to a
+    // modest expansion ratio (and the pooled buffer size). Anything bigger
+    // is reached by growing the buffer as the output actually arrives.
+    std::size_t size_hint = std::size_t(input.size) * 4;
+    if (format == compression_format::GZIP && input.size >= 18)
+    {
+        std::uint32_t recorded_size;
+        std::memcpy(&recorded_size, input.data + input.size - 4, 4);
+        size_hint = std::min(
+            std::size_t(recorded_size), std::size_t(input.size) * 32);
+    }
+    size_hint = std::min(size_hint, max_pooled_capacity);
+
+    decompressor::impl decoder(format, nullptr);
+    decoder.buffer = acquire_buffer(std::max(size_hint, std::size_t(1)));
+    decoder.feed(input.data, std::size_t(input.size));
+    decoder.finish();
+    return make_pooled_blob(std::move(decoder.buffer));
+}
+
+namespace {
+
+struct decompression_data
+{
+    // This is replaced whenever a new decompression starts, so that ones that
+    // are still in progress can tell if they're still wanted.
+    std::shared_ptr<int> token = std::make_shared<int>();
+};
+
+} // namespace
+
+async_signal<blob>
+decompress(alia::context ctx, readable<blob> input, compression_format format)
+{
+    auto& data = get_cached_data<decompression_data>(ctx);
+    return async<blob>(
+        ctx,
+        [&data, format](auto ctx, auto reporter, blob const& input) {
+            data.token = std::make_shared<int>();
+            std::weak_ptr<int> token = data.token;
+            auto result = std::make_shared<blob>();
+            auto error = std::make_shared<std::exception_ptr>();
+            run_in_background(
+                [format, input, result, error]() {
+                    try
+                    {
+                        *result = decompress(format, input);
+                    }
+                    catch (...)
+                    {
+                        *error = std::current_exception();
+                    }
+                },
+                // The input is captured here too, so that it's released on
+                // the main thread.
+                [input, reporter, result, error, token]() {
+                    if (token.expired())
+                        return;
+                    if (*error)
+                        reporter.report_failure(*error);
+                    else
+                        reporter.report_success(std::move(*result));
+                });
+        },
+        input);
+}
+
+}} // namespace alia::html
@@ -0,0 +1,96 @@
+#ifndef ALIA_HTML_DECOMPRESSION_HPP
+#define ALIA_HTML_DECOMPRESSION_HPP
+
+#include <alia/html/fetch.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace alia { namespace html {
+
+// DECOMPRESSION
+//
+// This decompresses gzip, deflate and Brotli data in wasm, for content that
+// the browser won't decode itself (e.g., pre-compressed files served as
+// application/octet-stream, or compressed blobs in storage).
+//
+// There are three ways to use it:
+//
+// - decompressor is a streaming stage. It can be fed the chunks of a
+//   fetch_stream() as they arrive.
+//
+// - decompress(format, input) decompresses a whole blob on the spot.
+//
+// - decompress(ctx, input, format) is a signal that decompresses its input
+//   in the background (see worker_pool.hpp). Given a response signal, e.g.,
+//
+//     decompress(ctx, alia_field(fetch(ctx, request), body), GZIP)
+//
+// Output is written into buffers that are recycled through a small pool, so
+// repeatedly decompressing similarly sized payloads (e.g., polling an
+// endpoint) doesn't keep reallocating them. A buffer returns to the pool when
+// the last blob that refers to it is released.
+//
+// Corrupt or truncated input is reported by throwing an alia::exception.
+//
+
+enum class compression_format
+{
+    GZIP,
+    // zlib-wrapped or raw deflate data (whichever the data turns out to be)
+    DEFLATE,
+    BROTLI
+};
+
+struct decompressor
+{
+    // The handler is called with each piece of output as it's produced. The
+    // data is only valid during the call.
+    typedef std::function<void(char const* data, std::size_t size)>
+        output_handler;
+
+    decompressor(compression_format format, output_handler output);
+
+    decompressor(decompressor&& other);
+
+    decompressor&
+    operator=(decompressor&& other);
+
+    ~decompressor();
+
+    // Feed in the next chunk of compressed data.
+    void
+    feed(char const* data, std::size_t size);
+
+    // Signal the end of the compressed data. This throws if the data was
+    // truncated.
+    void
+    finish();
+
+    // Has the end of the compressed data been seen?
+    bool
+    finished() const;
+
+ private:
+    friend blob
+    decompress(compression_format format, blob const& input);
+
+    struct impl;
+    std::unique_ptr<impl> impl_;
+};
+
+// Decompress an entire blob. The result is a pooled buffer.
+blob
+decompress(compression_format format, blob const& input);
+
+// Get a signal carrying the decompressed form of 'input'. The decompression
+// runs in the background (on a worker thread, if available), and the signal
+// fails if the input is corrupt.
+async_signal<blob>
+decompress(
+    alia::context ctx, readable<blob> input, compression_format format);
+
+}} // namespace alia::html
+
+#endif
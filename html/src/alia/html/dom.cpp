@@ -109,6 +109,15 @@ element_object::relocate(
                       << new_parent.asmdom_id << ", " << this->asmdom_id
                       << ", " << (before ? before->asmdom_id : 0) << std::endl;
 #endif
+            if (new_parent.has_list_transitions)
+            {
+                detail::insert_into_transitioning_list(
+                    new_parent.asmdom_id,
+                    this->asmdom_id,
+                    before ? before->asmdom_id : 0);
+                this->in_transitioning_list = true;
+                return;
+            }
             asmdom::direct::insertBefore(
                 new_parent.asmdom_id,
                 this->asmdom_id,
@@ -131,6 +140,7 @@ element_object::relocate(
             // Suppress warnings.
             break;
     }
+    this->in_transitioning_list = false;
 }
 
 void
@@ -140,6 +150,14 @@ element_object::remove()
 #ifdef ALIA_HTML_LOGGING
     std::cout << "asmdom::direct::remove: " << this->asmdom_id << std::endl;
 #endif
+    // Children of transitioning lists stay in the DOM until their exit
+    // animations finish. (They're still detached from our object tree.)
+    if (this->in_transitioning_list)
+    {
+        this->in_transitioning_list = false;
+        if (detail::remove_from_transitioning_list(this->asmdom_id))
+            return;
+    }
     asmdom::direct::remove(this->asmdom_id);
 }
 
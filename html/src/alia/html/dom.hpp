@@ -50,8 +50,27 @@ struct element_object
     node_type type = UNINITIALIZED;
 
     int asmdom_id = 0;
+
+    // Does this element animate the comings and goings of its children?
+    // (See transitions.hpp.)
+    bool has_list_transitions = false;
+    // Is this element currently a child of such an element?
+    bool in_transitioning_list = false;
 };
 
+namespace detail {
+
+// These are implemented in transitions.cpp.
+
+void
+insert_into_transitioning_list(int parent_id, int child_id, int before_id);
+
+// Returns true iff the node will remove itself after animating its exit.
+bool
+remove_from_transitioning_list(int asmdom_id);
+
+} // namespace detail
+
 void
 create_as_element(element_object& object, char const* type);
 
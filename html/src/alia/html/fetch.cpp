@@ -1,7 +1,20 @@
 #include "fetch.hpp"
 
+#include <alia/html/context.hpp>
+#include <alia/html/fetch_cache.hpp>
+#include <alia/html/fetch_initial_data.hpp>
+#include <alia/html/fetch_latency.hpp>
+#include <alia/html/fetch_persistence.hpp>
+
+#include <emscripten/emscripten.h>
 #include <emscripten/fetch.h>
 
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
 namespace alia { namespace html {
 
 std::string
@@ -30,13 +43,28 @@ to_blob(std::string s)
 }
 
 namespace {
+struct fetch_operation;
+}
+
+namespace detail {
 
-struct fetch_user_data
+// A fetch_subscription tracks the operation that is (currently) serving a
+// particular fetch signal (or fetch_handle), so that it can be abandoned.
+struct fetch_subscription : noncopyable
 {
-    http_request request;
-    async_reporter<http_response> reporter;
+    fetch_operation* operation = nullptr;
+    fetch_priority priority = fetch_priority::VISIBLE;
+    // This is replaced whenever the subscription is cancelled, so that
+    // pending deliveries from the cache can tell if they're still wanted.
+    std::shared_ptr<int> token = std::make_shared<int>();
 };
 
+} // namespace detail
+
+namespace {
+
+using detail::fetch_subscription;
+
 struct scoped_emscripten_fetch : noncopyable
 {
     explicit scoped_emscripten_fetch(emscripten_fetch_t* fetch) : fetch_(fetch)
@@ -52,37 +80,497 @@ struct scoped_emscripten_fetch : noncopyable
     emscripten_fetch_t* fetch_;
 };
 
+struct fetch_subscriber
+{
+    fetch_subscription* subscription = nullptr;
+    fetch_callback callback;
+    // If the subscriber was already given a stale response from the cache,
+    // this is its body.
+    bool has_stale_response = false;
+    blob stale_body;
+};
+
+// A fetch_operation is a single emscripten_fetch. Identical GET requests
+// that are issued while one is in flight all subscribe to the same operation
+// (and share the same response body).
+struct fetch_operation
+{
+    // This is null until the operation is actually sent.
+    emscripten_fetch_t* fetch = nullptr;
+    // when it was sent, according to emscripten_get_now()
+    double sent_at = 0;
+
+    // the duplicate request sent by the hedging policy (if any)
+    emscripten_fetch_t* hedge = nullptr;
+    double hedge_sent_at = 0;
+
+    // a unique ID, for identifying the operation from timer callbacks
+    unsigned id = 0;
+
+    http_request request;
+
+    // the origin that the request is addressed to, for scheduling purposes
+    std::string origin;
+
+    // the key that identifies the operation in the in-flight table, or an
+    // empty string if it can't be shared
+    std::string sharing_key;
+
+    // for cacheable requests...
+    bool cacheable = false;
+    std::string cache_key;
+    // the cached response that this request is revalidating (if any)
+    bool revalidating = false;
+    http_response cached_response;
+
+    // Is the operation reading the persisted copy of the response because
+    // the network request failed?
+    bool reading_persisted_copy = false;
+
+    std::vector<fetch_subscriber> subscribers;
+
+    // the number of bytes received so far
+    std::uint64_t bytes_received = 0;
+};
+
+std::unordered_map<std::string, fetch_operation*> in_flight_fetches;
+
+fetch_statistics the_fetch_statistics;
+
+// Close a fetch that we're no longer interested in.
+void
+close_fetch(emscripten_fetch_t* fetch)
+{
+    // emscripten_fetch_close invokes the error handler for fetches that are
+    // still in progress, so detach the operation first.
+    fetch->userData = nullptr;
+    emscripten_fetch_close(fetch);
+}
+
+// HEDGING - Operations that are waiting to be hedged are registered here (by
+// ID), so that the hedging timers can tell if they're still around.
+std::unordered_map<unsigned, fetch_operation*> operations_awaiting_hedge;
+
+unsigned next_operation_id = 1;
+
+// SCHEDULING - Operations wait in per-origin queues until the origin has a
+// free slot. When slots open up, the most urgent operations are sent first.
+// (Within the same priority class, operations are sent in the order they were
+// issued.)
+
+struct origin_queue
+{
+    unsigned in_flight = 0;
+    // the operations waiting to be sent, in the order they were issued
+    std::vector<fetch_operation*> waiting;
+};
+
+std::unordered_map<std::string, origin_queue> origin_queues;
+
+fetch_scheduler_config the_scheduler_config;
+
+bool dispatch_scheduled = false;
+
+void
+send_fetch_operation(fetch_operation* operation);
+
+std::string
+get_origin(std::string const& url)
+{
+    auto scheme_end = url.find("://");
+    // Relative URLs all refer to the page's own origin.
+    if (scheme_end == std::string::npos)
+        return std::string();
+    return url.substr(0, url.find('/', scheme_end + 3));
+}
+
+// An operation is as urgent as its most urgent subscriber.
+fetch_priority
+get_priority(fetch_operation const& operation)
+{
+    fetch_priority priority = fetch_priority::PREFETCH;
+    for (auto const& subscriber : operation.subscribers)
+    {
+        if (subscriber.subscription
+            && subscriber.subscription->priority > priority)
+        {
+            priority = subscriber.subscription->priority;
+        }
+    }
+    return priority;
+}
+
+void
+dispatch_queued_fetches()
+{
+    for (auto& origin : origin_queues)
+    {
+        auto& queue = origin.second;
+        while (queue.in_flight < the_scheduler_config.max_in_flight_per_origin
+               && !queue.waiting.empty())
+        {
+            auto next = queue.waiting.begin();
+            for (auto i = next + 1; i != queue.waiting.end(); ++i)
+            {
+                if (get_priority(**i) > get_priority(**next))
+                    next = i;
+            }
+            auto* operation = *next;
+            queue.waiting.erase(next);
+            ++queue.in_flight;
+            send_fetch_operation(operation);
+        }
+    }
+}
+
+void
+dispatch_callback(void*)
+{
+    dispatch_scheduled = false;
+    dispatch_queued_fetches();
+}
+
+// Dispatching is deferred until the current event (usually a refresh) is
+// finished, so that all the requests that it issues compete on priority.
+void
+schedule_dispatch()
+{
+    if (!dispatch_scheduled)
+    {
+        dispatch_scheduled = true;
+        emscripten_async_call(dispatch_callback, nullptr, 0);
+    }
+}
+
+void
+enqueue_fetch_operation(fetch_operation* operation)
+{
+    operation->origin = get_origin(operation->request.url);
+    origin_queues[operation->origin].waiting.push_back(operation);
+    schedule_dispatch();
+}
+
+// Release the slot that a sent operation was occupying.
+void
+release_fetch_slot(fetch_operation const& operation)
+{
+    --origin_queues[operation.origin].in_flight;
+    schedule_dispatch();
+}
+
+// Abort an operation that no one is interested in anymore.
+void
+abort_fetch_operation(fetch_operation* operation)
+{
+    if (!operation->sharing_key.empty())
+        in_flight_fetches.erase(operation->sharing_key);
+
+    operations_awaiting_hedge.erase(operation->id);
+
+    if (operation->fetch)
+    {
+        ++the_fetch_statistics.aborted_requests;
+        the_fetch_statistics.aborted_bytes += operation->bytes_received;
+
+        close_fetch(operation->fetch);
+        if (operation->hedge)
+            close_fetch(operation->hedge);
+
+        release_fetch_slot(*operation);
+    }
+    else
+    {
+        auto& waiting = origin_queues[operation->origin].waiting;
+        waiting.erase(
+            std::remove(waiting.begin(), waiting.end(), operation),
+            waiting.end());
+    }
+
+    delete operation;
+}
+
+void
+cancel_fetch_subscription(fetch_subscription& subscription)
+{
+    subscription.token = std::make_shared<int>();
+
+    auto* operation = subscription.operation;
+    if (!operation)
+        return;
+    subscription.operation = nullptr;
+
+    auto& subscribers = operation->subscribers;
+    subscribers.erase(
+        std::remove_if(
+            subscribers.begin(),
+            subscribers.end(),
+            [&](fetch_subscriber const& s) {
+                return s.subscription == &subscription;
+            }),
+        subscribers.end());
+
+    if (subscribers.empty())
+        abort_fetch_operation(operation);
+}
+
+// Get the key that determines whether or not two requests can share the same
+// operation. (Only GET requests can be shared.)
+std::string
+get_sharing_key(http_request const& request)
+{
+    if (request.method != http_method::GET)
+        return std::string();
+    std::string key = request.url;
+    for (auto const& header : request.headers)
+        key += "\n" + header.first + ": " + header.second;
+    if (request.persistence.mode != persistence_mode::NONE)
+    {
+        key += "\n(persistence: "
+               + std::to_string(int(request.persistence.mode)) + " "
+               + request.persistence.version + ")";
+    }
+    return key;
+}
+
+http_headers
+get_response_headers(emscripten_fetch_t* fetch)
+{
+    http_headers headers;
+    std::size_t length = emscripten_fetch_get_response_headers_length(fetch);
+    if (length == 0)
+        return headers;
+    std::string raw(length + 1, '\0');
+    emscripten_fetch_get_response_headers(fetch, &raw[0], length + 1);
+    raw.resize(length);
+
+    // The headers come as 'Name: value' lines.
+    std::size_t line_start = 0;
+    while (line_start < raw.size())
+    {
+        auto line_end = raw.find("\r\n", line_start);
+        if (line_end == std::string::npos)
+            line_end = raw.size();
+        auto colon = raw.find(':', line_start);
+        if (colon < line_end)
+        {
+            std::string name = raw.substr(line_start, colon - line_start);
+            for (auto& c : name)
+                c = char(std::tolower(static_cast<unsigned char>(c)));
+            auto value_start = raw.find_first_not_of(' ', colon + 1);
+            if (value_start > line_end)
+                value_start = line_end;
+            headers[name] = raw.substr(value_start, line_end - value_start);
+        }
+        line_start = line_end + 2;
+    }
+    return headers;
+}
+
+bool
+bodies_match(blob const& a, blob const& b)
+{
+    return a.size == b.size
+           && (a.data == b.data
+               || std::memcmp(a.data, b.data, std::size_t(a.size)) == 0);
+}
+
+void
+report_to_subscriber(
+    fetch_subscriber const& subscriber, http_response const& response)
+{
+    if (subscriber.has_stale_response)
+    {
+        // The subscriber already has the stale response, so it only needs to
+        // hear about this one if it's actually different. (If revalidation
+        // failed, the stale response is the best we have, so stick with it.)
+        if (response.status_code == 200
+            && !bodies_match(response.body, subscriber.stale_body))
+        {
+            subscriber.callback(response);
+        }
+    }
+    else
+    {
+        subscriber.callback(response);
+    }
+}
+
+void
+handle_fetch_progress(emscripten_fetch_t* fetch)
+{
+    auto* operation = reinterpret_cast<fetch_operation*>(fetch->userData);
+    if (operation)
+        operation->bytes_received = fetch->dataOffset + fetch->numBytes;
+}
+
+bool
+is_persistent(http_request const& request)
+{
+    return request.method == http_method::GET
+           && request.persistence.mode != persistence_mode::NONE;
+}
+
 void
 handle_fetch_response(emscripten_fetch_t* fetch)
 {
+    // If the operation was aborted, there's nothing to do.
+    if (!fetch->userData)
+        return;
+
+    // If the request was hedged, the first response wins and the other
+    // request is aborted... unless this one failed outright, in which case we
+    // wait for the other one.
+    {
+        auto* operation = reinterpret_cast<fetch_operation*>(fetch->userData);
+        operations_awaiting_hedge.erase(operation->id);
+        if (operation->hedge)
+        {
+            bool is_hedge = fetch == operation->hedge;
+            auto* other = is_hedge ? operation->fetch : operation->hedge;
+            if (fetch->status == 0)
+            {
+                emscripten_fetch_close(fetch);
+                operation->fetch = other;
+                operation->hedge = nullptr;
+                return;
+            }
+            close_fetch(other);
+            if (is_hedge)
+            {
+                ++the_fetch_statistics.hedges_won;
+                operation->sent_at = operation->hedge_sent_at;
+            }
+            operation->fetch = fetch;
+            operation->hedge = nullptr;
+        }
+    }
+
+    // If a network-first request failed to reach the network, retry it
+    // against the persisted copy. (This keeps the operation's slot.)
+    {
+        auto* operation = reinterpret_cast<fetch_operation*>(fetch->userData);
+        if (is_persistent(operation->request)
+            && operation->request.persistence.mode
+                   == persistence_mode::NETWORK_FIRST
+            && !operation->reading_persisted_copy && fetch->status == 0)
+        {
+            emscripten_fetch_close(fetch);
+            operation->reading_persisted_copy = true;
+            send_fetch_operation(operation);
+            return;
+        }
+    }
+
     std::shared_ptr<scoped_emscripten_fetch> fetch_ownership(
         new scoped_emscripten_fetch(fetch));
 
-    // Grab our data from the Emscripten fetch object and assume ownership of
-    // it.
-    std::unique_ptr<fetch_user_data> data(
-        reinterpret_cast<fetch_user_data*>(fetch->userData));
+    // Grab our operation from the Emscripten fetch object and assume
+    // ownership of it.
+    std::unique_ptr<fetch_operation> operation(
+        reinterpret_cast<fetch_operation*>(fetch->userData));
+    if (!operation->sharing_key.empty())
+        in_flight_fetches.erase(operation->sharing_key);
+    release_fetch_slot(*operation);
+
+    if (fetch->status != 0)
+    {
+        detail::record_fetch_latency(
+            operation->request, emscripten_get_now() - operation->sent_at);
+    }
 
     // Construct the response.
     http_response response;
     response.status_code = fetch->status;
     response.body = blob{fetch->data, fetch->numBytes, fetch_ownership};
+    response.headers = get_response_headers(fetch);
+
+    if (is_persistent(operation->request) && response.status_code == 200)
+    {
+        detail::record_persistent_response(
+            operation->request, response.body.size);
+    }
 
-    // Invoke the callback.
-    data->reporter.report_success(response);
+    if (operation->cacheable)
+    {
+        if (response.status_code == 304 && operation->revalidating)
+        {
+            detail::revalidate_cached_response(
+                operation->cache_key, response);
+            response = operation->cached_response;
+        }
+        else
+        {
+            detail::store_cached_response(
+                operation->cache_key, operation->request.url, response);
+        }
+    }
+
+    // Fan the response out to all subscribers. They all share the same body.
+    // (The subscriptions are all detached first, since callbacks are free to
+    // drop their own subscriptions or others.)
+    for (auto const& subscriber : operation->subscribers)
+    {
+        if (subscriber.subscription)
+            subscriber.subscription->operation = nullptr;
+    }
+    for (auto const& subscriber : operation->subscribers)
+        report_to_subscriber(subscriber, response);
 }
 
+struct cached_delivery
+{
+    std::weak_ptr<int> token;
+    fetch_callback callback;
+    http_response response;
+};
+
 void
-launch_fetch_operation(
-    alia::dataless_context ctx,
-    async_reporter<http_response> reporter,
-    http_request const& request)
+deliver_cached_response(void* arg)
+{
+    std::unique_ptr<cached_delivery> delivery(
+        reinterpret_cast<cached_delivery*>(arg));
+    if (!delivery->token.expired())
+        delivery->callback(delivery->response);
+}
+
+// Deliver a cached response. This is done asynchronously, since we're in the
+// middle of launching the operation.
+void
+schedule_cached_delivery(
+    fetch_subscription const& subscription,
+    fetch_callback const& callback,
+    http_response const& response)
+{
+    emscripten_async_call(
+        deliver_cached_response,
+        new cached_delivery{subscription.token, callback, response},
+        0);
+}
+
+emscripten_fetch_t*
+issue_fetch(fetch_operation* operation, millisecond_count timeout)
 {
     emscripten_fetch_attr_t attr;
     emscripten_fetch_attr_init(&attr);
 
+    auto const& request = operation->request;
+
     attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY;
 
+    // Emscripten's fetch layer handles the actual persistence. By default,
+    // it checks IndexedDB before going to the network.
+    std::string persistent_path;
+    if (is_persistent(request))
+    {
+        persistent_path = detail::get_persistent_path(request);
+        attr.destinationPath = persistent_path.c_str();
+        attr.attributes |= EMSCRIPTEN_FETCH_PERSIST_FILE;
+        if (operation->reading_persisted_copy)
+            attr.attributes |= EMSCRIPTEN_FETCH_NO_DOWNLOAD;
+        else if (request.persistence.mode == persistence_mode::NETWORK_FIRST)
+            attr.attributes |= EMSCRIPTEN_FETCH_REPLACE;
+    }
+
     attr.onsuccess = handle_fetch_response;
     // Emscripten doesn't seem to have a way to distinguish between actual
     // network errors and HTTP status codes outside the 2xx range, so I think
@@ -90,15 +578,11 @@ launch_fetch_operation(
     // the normal data flow and let the application handle non-2xx codes how it
     // sees fit.
     attr.onerror = handle_fetch_response;
-
-    std::unique_ptr<fetch_user_data> user_data(new fetch_user_data);
-    user_data->request = request;
-    user_data->reporter = reporter;
-    auto const& persistent_request = user_data->request;
+    attr.onprogress = handle_fetch_progress;
 
     std::vector<char const*> headers;
     headers.reserve(request.headers.size() * 2 + 1);
-    for (auto const& h : persistent_request.headers)
+    for (auto const& h : request.headers)
     {
         headers.push_back(h.first.c_str());
         headers.push_back(h.second.c_str());
@@ -106,25 +590,292 @@ launch_fetch_operation(
     headers.push_back(0);
     attr.requestHeaders = &headers[0];
 
-    attr.requestData = persistent_request.body.data;
-    attr.requestDataSize = persistent_request.body.size;
+    attr.requestData = request.body.data;
+    attr.requestDataSize = request.body.size;
+
+    attr.timeoutMSecs = timeout;
 
     auto method_string = to_string(request.method);
 
-    attr.userData = user_data.get();
+    attr.userData = operation;
 
     strcpy(attr.requestMethod, method_string.c_str());
-    emscripten_fetch(&attr, request.url.c_str());
 
-    user_data.release();
+    return emscripten_fetch(&attr, request.url.c_str());
+}
+
+void
+hedge_callback(void* arg)
+{
+    auto i = operations_awaiting_hedge.find(
+        unsigned(reinterpret_cast<std::uintptr_t>(arg)));
+    if (i == operations_awaiting_hedge.end())
+        return;
+    auto* operation = i->second;
+    operations_awaiting_hedge.erase(i);
+
+    // The hedge has to respect the original deadline.
+    millisecond_count timeout = 0;
+    auto const& request = operation->request;
+    if (request.deadline != 0)
+    {
+        double remaining = double(request.deadline)
+                           - (emscripten_get_now() - operation->sent_at);
+        if (remaining < 1)
+            return;
+        timeout = millisecond_count(remaining);
+    }
+
+    operation->hedge = issue_fetch(operation, timeout);
+    operation->hedge_sent_at = emscripten_get_now();
+    ++the_fetch_statistics.hedged_requests;
 }
 
+void
+arm_hedging_timer(fetch_operation* operation)
+{
+    auto const& request = operation->request;
+    auto const& policy = request.hedging;
+    // POST requests may not be idempotent, and requests that go through
+    // persistence already have a fallback.
+    if (!policy.enabled || request.method == http_method::POST
+        || is_persistent(request))
+    {
+        return;
+    }
+
+    millisecond_count delay;
+    if (!get_fetch_latency_percentile(request, policy.percentile, &delay))
+        delay = policy.initial_delay;
+    if (delay < policy.minimum_delay)
+        delay = policy.minimum_delay;
+    if (request.deadline != 0 && delay >= request.deadline)
+        return;
+
+    operations_awaiting_hedge[operation->id] = operation;
+    emscripten_async_call(
+        hedge_callback,
+        reinterpret_cast<void*>(std::uintptr_t(operation->id)),
+        int(delay));
+}
+
+void
+send_fetch_operation(fetch_operation* operation)
+{
+    operation->fetch = issue_fetch(operation, operation->request.deadline);
+    operation->sent_at = emscripten_get_now();
+    if (!operation->reading_persisted_copy)
+        arm_hedging_timer(operation);
+}
+
+void
+launch_fetch_operation(
+    fetch_subscription& subscription,
+    fetch_callback callback,
+    http_request const& request)
+{
+    // Whatever the subscription was waiting on before has been superseded.
+    cancel_fetch_subscription(subscription);
+
+    fetch_subscriber subscriber;
+    subscriber.subscription = &subscription;
+    subscriber.callback = std::move(callback);
+
+    // Check the initial data that was embedded in the page.
+    http_response initial_response;
+    if (detail::take_initial_fetch_response(request, &initial_response))
+    {
+        if (detail::is_cacheable(request))
+        {
+            detail::store_cached_response(
+                detail::get_fetch_cache_key(request),
+                request.url,
+                initial_response);
+        }
+        schedule_cached_delivery(
+            subscription, subscriber.callback, initial_response);
+        return;
+    }
+
+    // Check the cache.
+    bool cacheable = detail::is_cacheable(request);
+    std::string cache_key;
+    detail::cached_response cached;
+    bool has_cached_response = false;
+    if (cacheable)
+    {
+        cache_key = detail::get_fetch_cache_key(request);
+        has_cached_response
+            = detail::look_up_cached_response(cache_key, &cached);
+        if (has_cached_response
+            && cached.freshness != detail::cache_freshness::EXPIRED)
+        {
+            schedule_cached_delivery(
+                subscription, subscriber.callback, cached.response);
+            if (cached.freshness == detail::cache_freshness::FRESH)
+                return;
+            subscriber.has_stale_response = true;
+            subscriber.stale_body = cached.response.body;
+        }
+    }
+
+    // If an identical request is already in flight, just subscribe to it.
+    auto sharing_key = get_sharing_key(request);
+    if (!sharing_key.empty())
+    {
+        auto existing = in_flight_fetches.find(sharing_key);
+        if (existing != in_flight_fetches.end())
+        {
+            existing->second->subscribers.push_back(std::move(subscriber));
+            subscription.operation = existing->second;
+            return;
+        }
+    }
+
+    std::unique_ptr<fetch_operation> operation(new fetch_operation);
+    operation->id = next_operation_id++;
+    operation->request = request;
+    operation->sharing_key = std::move(sharing_key);
+    operation->cacheable = cacheable;
+    operation->cache_key = std::move(cache_key);
+    if (has_cached_response)
+    {
+        operation->revalidating = true;
+        operation->cached_response = cached.response;
+        if (!cached.etag.empty())
+            operation->request.headers["If-None-Match"] = cached.etag;
+    }
+    operation->subscribers.push_back(std::move(subscriber));
+    subscription.operation = operation.get();
+
+    if (!operation->sharing_key.empty())
+        in_flight_fetches[operation->sharing_key] = operation.get();
+
+    enqueue_fetch_operation(operation.release());
+}
+
+struct fetch_signal_data : noncopyable
+{
+    ~fetch_signal_data()
+    {
+        cancel_fetch_subscription(subscription);
+    }
+
+    fetch_subscription subscription;
+    detail::fetch_delivery delivery;
+};
+
 } // namespace
 
-async_signal<http_response>
+namespace detail {
+
+void
+fetch_subscription_deleter::operator()(fetch_subscription* subscription) const
+{
+    cancel_fetch_subscription(*subscription);
+    delete subscription;
+}
+
+} // namespace detail
+
+fetch_handle
+launch_fetch(
+    http_request const& request,
+    fetch_callback callback,
+    fetch_priority priority)
+{
+    fetch_handle handle(new fetch_subscription);
+    handle->priority = priority;
+    launch_fetch_operation(*handle, std::move(callback), request);
+    return handle;
+}
+
+fetch_priority
+get_fetch_priority(fetch_handle const& handle)
+{
+    return handle->priority;
+}
+
+void
+set_fetch_priority(fetch_handle& handle, fetch_priority priority)
+{
+    handle->priority = priority;
+}
+
+bool
+fetch_in_flight(fetch_handle const& handle)
+{
+    return handle->operation != nullptr;
+}
+
+fetch_statistics const&
+get_fetch_statistics()
+{
+    return the_fetch_statistics;
+}
+
+void
+configure_fetch_scheduler(fetch_scheduler_config const& config)
+{
+    the_scheduler_config = config;
+    schedule_dispatch();
+}
+
+fetch_signal
 fetch(alia::context ctx, readable<http_request> request)
 {
-    return async<http_response>(ctx, launch_fetch_operation, request);
+    return fetch(ctx, request, value(fetch_priority::VISIBLE));
+}
+
+fetch_signal
+fetch(
+    alia::context ctx,
+    readable<http_request> request,
+    readable<fetch_priority> priority)
+{
+    auto& data = get_cached_data<fetch_signal_data>(ctx);
+
+    refresh_handler(ctx, [&](auto ctx) {
+        // If the request goes away, so does our interest in its response.
+        if (!signal_has_value(request))
+            cancel_fetch_subscription(data.subscription);
+
+        // Priority changes only matter while the operation is still queued,
+        // and queued operations are ranked when they're dispatched, so just
+        // recording the new priority is enough.
+        if (signal_has_value(priority))
+            data.subscription.priority = read_signal(priority);
+    });
+
+    auto* system = &get<alia::system_tag>(ctx);
+    auto operation = async<http_response>(
+        ctx,
+        [&data, system](auto ctx, auto reporter, http_request const& request) {
+            // The first delivery completes the async operation. A second one
+            // (a revalidated response replacing a stale one, which is only
+            // delivered if its body differs) just updates the delivery and
+            // refreshes.
+            auto completed = std::make_shared<bool>(false);
+            launch_fetch_operation(
+                data.subscription,
+                [&data, system, reporter, completed](
+                    http_response const& response) {
+                    data.delivery.response = response;
+                    ++data.delivery.revision;
+                    if (!*completed)
+                    {
+                        *completed = true;
+                        reporter.report_success(response);
+                    }
+                    else
+                    {
+                        refresh_system_when_visible(*system);
+                    }
+                },
+                request);
+        },
+        request);
+    return fetch_signal(operation, &data.delivery);
 }
 
 namespace {
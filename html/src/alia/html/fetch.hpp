@@ -4,7 +4,9 @@
 #include <alia.hpp>
 #include <alia/html/common.hpp>
 
+#include <functional>
 #include <map>
+#include <memory>
 #include <string>
 
 namespace alia { namespace html {
@@ -22,18 +24,64 @@ to_string(http_method method);
 
 typedef std::map<std::string, std::string> http_headers;
 
+// Responses to GET requests can be persisted in IndexedDB, so that they
+// survive across visits. (See fetch_persistence.hpp.)
+enum class persistence_mode
+{
+    // Don't persist the response.
+    NONE,
+    // Use the persisted response if there is one, and only go to the network
+    // if there isn't.
+    CACHE_FIRST,
+    // Always go to the network (and persist the result), but fall back to
+    // the persisted response if the network request fails.
+    NETWORK_FIRST
+};
+
+struct persistence_policy
+{
+    persistence_mode mode = persistence_mode::NONE;
+    // Persisted responses are only used by requests with the same version
+    // string, so changing this invalidates them.
+    std::string version;
+};
+
+// A hedging policy sends a duplicate of a request if the response is taking
+// longer than usual for its endpoint. Whichever response arrives first is
+// used, and the other request is aborted. (See fetch_latency.hpp.)
+// POST requests are never hedged, since they may not be idempotent.
+struct hedging_policy
+{
+    bool enabled = false;
+    // The duplicate is sent once the request has been outstanding for longer
+    // than this percentile of the endpoint's recorded latencies...
+    double percentile = 0.95;
+    // or, if the endpoint doesn't have enough recorded latencies yet, after
+    // this delay.
+    millisecond_count initial_delay = 500;
+    // the minimum delay before hedging
+    millisecond_count minimum_delay = 20;
+};
+
 struct http_request
 {
     http_method method;
     std::string url;
     http_headers headers;
     blob body;
+    persistence_policy persistence;
+    // If this is nonzero, the request fails (with a status code of 0) if no
+    // response arrives within this many milliseconds of it being sent.
+    millisecond_count deadline = 0;
+    hedging_policy hedging;
 };
 
 struct http_response
 {
     int status_code;
     blob body;
+    // Header names are in lowercase.
+    http_headers headers;
 };
 
 struct http_error
@@ -42,9 +90,160 @@ struct http_error
     http_response response;
 };
 
-async_signal<http_response>
+// Fetches are queued per origin and sent in order of priority (and then in
+// the order they were issued) when more are pending than the scheduler
+// allows in flight.
+enum class fetch_priority
+{
+    // speculative requests for data that may never be needed
+    PREFETCH,
+    // requests for content that's currently visible (the default)
+    VISIBLE,
+    // requests for data that the page can't render without
+    CRITICAL
+};
+
+struct fetch_scheduler_config
+{
+    // the maximum number of requests in flight to any one origin - This
+    // should stay within the browser's own per-host connection limit.
+    unsigned max_in_flight_per_origin = 6;
+};
+
+void
+configure_fetch_scheduler(fetch_scheduler_config const& config);
+
+namespace detail {
+
+// the latest response delivered to a fetch() signal - One fetch can deliver
+// twice (a stale response from the cache and then its revalidated
+// replacement), and each delivery gets a new revision.
+struct fetch_delivery
+{
+    http_response response;
+    unsigned revision = 0;
+};
+
+} // namespace detail
+
+// the signal returned by fetch() - Its value ID changes with each delivery,
+// so anything computed from a stale response is recomputed when the
+// revalidated response replaces it.
+struct fetch_signal : signal<fetch_signal, http_response, read_only_signal>
+{
+    fetch_signal(
+        async_signal<http_response> operation,
+        detail::fetch_delivery const* delivery)
+        : operation_(std::move(operation)), delivery_(delivery)
+    {
+    }
+
+    bool
+    has_value() const override
+    {
+        return operation_.has_value();
+    }
+
+    http_response const&
+    read() const override
+    {
+        return delivery_->response;
+    }
+
+    simple_id<unsigned> const&
+    value_id() const override
+    {
+        id_ = make_id(delivery_->revision);
+        return id_;
+    }
+
+ private:
+    async_signal<http_response> operation_;
+    detail::fetch_delivery const* delivery_;
+    mutable simple_id<unsigned> id_;
+};
+
+// Fetch the response to an HTTP request.
+//
+// If the component goes away or the request changes while the fetch is in
+// flight, the fetch is aborted (unless other components are waiting on the
+// same response).
+//
+// If a stale response is served from the cache, the signal takes on that
+// response right away and is updated later if revalidation turns up a
+// different body.
+//
+fetch_signal
 fetch(alia::context ctx, readable<http_request> request);
 
+// Fetch with an explicit priority. The priority can change while the request
+// is queued (e.g., when the requesting content scrolls into view).
+fetch_signal
+fetch(
+    alia::context ctx,
+    readable<http_request> request,
+    readable<fetch_priority> priority);
+
+typedef std::function<void(http_response const&)> fetch_callback;
+
+namespace detail {
+
+struct fetch_subscription;
+
+struct fetch_subscription_deleter
+{
+    void
+    operator()(fetch_subscription* subscription) const;
+};
+
+} // namespace detail
+
+// A fetch_handle represents interest in the response to a request issued
+// through launch_fetch(). Destroying (or resetting) it abandons the request.
+typedef std::unique_ptr<
+    detail::fetch_subscription,
+    detail::fetch_subscription_deleter>
+    fetch_handle;
+
+// Issue a request outside of the signal graph. This goes through the same
+// caching, deduplication and scheduling as fetch(). The callback is invoked
+// (outside of any refresh) with the response. It may be invoked a second time
+// if a stale response from the cache is superseded.
+fetch_handle
+launch_fetch(
+    http_request const& request,
+    fetch_callback callback,
+    fetch_priority priority = fetch_priority::VISIBLE);
+
+// Get/set the priority of a request issued through launch_fetch(). (As with
+// fetch(), the priority only matters while the request is queued.)
+fetch_priority
+get_fetch_priority(fetch_handle const& handle);
+void
+set_fetch_priority(fetch_handle& handle, fetch_priority priority);
+
+// Is a request issued through launch_fetch() still waiting on the network?
+// This goes false once the final response is in, even if the callback wasn't
+// invoked again because the response matched a stale one from the cache.
+bool
+fetch_in_flight(fetch_handle const& handle);
+
+// statistics about fetches that were aborted because no one was waiting on
+// them anymore, and about hedging
+struct fetch_statistics
+{
+    unsigned aborted_requests = 0;
+    // the number of bytes that the aborted requests had already received
+    std::uint64_t aborted_bytes = 0;
+    // the number of duplicate requests sent by hedging policies
+    unsigned hedged_requests = 0;
+    // the number of times that the duplicate won
+    unsigned hedges_won = 0;
+};
+
+fetch_statistics const&
+get_fetch_statistics();
+
 apply_signal<std::string>
 fetch_text(alia::context ctx, readable<std::string> path);
 
@@ -0,0 +1,262 @@
+#include <alia/html/fetch_batch.hpp>
+
+#include <emscripten/emscripten.h>
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+namespace alia { namespace html {
+
+namespace {
+
+struct batch_operation;
+
+// A batch_subscription tracks the batch that is (currently) serving a
+// particular batched_fetch signal.
+struct batch_subscription : noncopyable
+{
+    batch_operation* operation = nullptr;
+};
+
+struct batch_subscriber
+{
+    batch_subscription* subscription;
+    // the index of the subscriber's key within the batch
+    std::size_t key_index;
+    fetch_callback callback;
+};
+
+struct batch_operation
+{
+    batch_adapter const* adapter = nullptr;
+    std::vector<std::string> keys;
+    std::map<std::string, std::size_t> key_indices;
+    std::vector<batch_subscriber> subscribers;
+    // This is null until the batch is sent.
+    fetch_handle handle;
+};
+
+// batches that are still collecting keys, by adapter
+std::unordered_map<batch_adapter const*, batch_operation*> pending_batches;
+
+bool flush_scheduled = false;
+
+std::string
+make_batch_url(
+    std::string const& url_template, std::vector<std::string> const& keys)
+{
+    std::string joined_keys;
+    for (auto const& key : keys)
+    {
+        if (!joined_keys.empty())
+            joined_keys += ',';
+        joined_keys += key;
+    }
+
+    static std::string const placeholder = "{keys}";
+    std::string url;
+    std::size_t position = 0;
+    while (true)
+    {
+        auto next = url_template.find(placeholder, position);
+        if (next == std::string::npos)
+            break;
+        url.append(url_template, position, next - position);
+        url += joined_keys;
+        position = next + placeholder.size();
+    }
+    url.append(url_template, position, std::string::npos);
+    return url;
+}
+
+void
+deliver_batch_response(
+    batch_operation* operation, http_response const& response)
+{
+    std::vector<http_response> responses;
+    bool succeeded
+        = response.status_code >= 200 && response.status_code < 300;
+    if (succeeded)
+    {
+        responses
+            = operation->adapter->split_response(operation->keys, response);
+    }
+
+    // Collect everything first, since the callbacks are free to cancel
+    // subscriptions (and thus destroy the operation).
+    std::vector<std::pair<fetch_callback, http_response>> deliveries;
+    deliveries.reserve(operation->subscribers.size());
+    for (auto const& subscriber : operation->subscribers)
+    {
+        if (!succeeded)
+        {
+            deliveries.emplace_back(subscriber.callback, response);
+        }
+        else if (subscriber.key_index < responses.size())
+        {
+            deliveries.emplace_back(
+                subscriber.callback, responses[subscriber.key_index]);
+        }
+        else
+        {
+            // The splitter didn't hold up its end of the bargain, so treat
+            // this like a network failure.
+            deliveries.emplace_back(
+                subscriber.callback, http_response{0, blob(), http_headers()});
+        }
+    }
+
+    for (auto const& delivery : deliveries)
+        delivery.first(delivery.second);
+}
+
+void
+send_batch(batch_operation* operation)
+{
+    auto const& adapter = *operation->adapter;
+    http_request request;
+    request.method = adapter.method;
+    request.url = make_batch_url(adapter.url_template, operation->keys);
+    request.headers = adapter.headers;
+    if (adapter.encode_body)
+        request.body = adapter.encode_body(operation->keys);
+
+    // The operation stays alive (and keeps the handle) as long as it has
+    // subscribers, so the response may be delivered more than once (e.g.,
+    // when a stale response from the cache is superseded).
+    operation->handle
+        = launch_fetch(request, [operation](http_response const& response) {
+              deliver_batch_response(operation, response);
+          });
+}
+
+void
+flush_pending_batches(void*)
+{
+    flush_scheduled = false;
+    auto batches = std::move(pending_batches);
+    pending_batches.clear();
+    for (auto& batch : batches)
+        send_batch(batch.second);
+}
+
+void
+cancel_batch_subscription(batch_subscription& subscription)
+{
+    auto* operation = subscription.operation;
+    if (!operation)
+        return;
+    subscription.operation = nullptr;
+
+    auto& subscribers = operation->subscribers;
+    subscribers.erase(
+        std::remove_if(
+            subscribers.begin(),
+            subscribers.end(),
+            [&](batch_subscriber const& s) {
+                return s.subscription == &subscription;
+            }),
+        subscribers.end());
+
+    // Abandoned keys are left in pending batches. They're harmless, and
+    // removing them would shift the indices of the others.
+    if (subscribers.empty())
+    {
+        auto pending = pending_batches.find(operation->adapter);
+        if (pending != pending_batches.end() && pending->second == operation)
+            pending_batches.erase(pending);
+        // Destroying the handle abandons the batch request if it's in flight.
+        delete operation;
+    }
+}
+
+void
+add_to_batch(
+    batch_subscription& subscription,
+    batch_adapter const& adapter,
+    std::string const& key,
+    fetch_callback callback)
+{
+    cancel_batch_subscription(subscription);
+
+    auto*& operation = pending_batches[&adapter];
+    if (!operation)
+    {
+        operation = new batch_operation;
+        operation->adapter = &adapter;
+    }
+
+    std::size_t key_index;
+    auto existing = operation->key_indices.find(key);
+    if (existing != operation->key_indices.end())
+    {
+        key_index = existing->second;
+    }
+    else
+    {
+        key_index = operation->keys.size();
+        operation->keys.push_back(key);
+        operation->key_indices[key] = key_index;
+    }
+
+    operation->subscribers.push_back(
+        batch_subscriber{&subscription, key_index, std::move(callback)});
+    subscription.operation = operation;
+
+    // Full batches are sent right away (without waiting for the flush), so
+    // the next key starts a new batch.
+    if (operation->keys.size() >= adapter.max_batch_size)
+    {
+        auto* full = operation;
+        pending_batches.erase(&adapter);
+        send_batch(full);
+    }
+    else if (!flush_scheduled)
+    {
+        flush_scheduled = true;
+        emscripten_async_call(flush_pending_batches, nullptr, 0);
+    }
+}
+
+struct batch_signal_data : noncopyable
+{
+    ~batch_signal_data()
+    {
+        cancel_batch_subscription(subscription);
+    }
+
+    batch_subscription subscription;
+};
+
+} // namespace
+
+async_signal<http_response>
+batched_fetch(
+    alia::context ctx,
+    batch_adapter const& adapter,
+    readable<std::string> key)
+{
+    auto& data = get_cached_data<batch_signal_data>(ctx);
+
+    refresh_handler(ctx, [&](auto ctx) {
+        // If the key goes away, so does our interest in its response.
+        if (!signal_has_value(key))
+            cancel_batch_subscription(data.subscription);
+    });
+
+    return async<http_response>(
+        ctx,
+        [&](auto ctx, auto reporter, std::string const& key) {
+            add_to_batch(
+                data.subscription,
+                adapter,
+                key,
+                [reporter](http_response const& response) {
+                    reporter.report_success(response);
+                });
+        },
+        key);
+}
+
+}} // namespace alia::html
@@ -0,0 +1,71 @@
+#ifndef ALIA_HTML_FETCH_BATCH_HPP
+#define ALIA_HTML_FETCH_BATCH_HPP
+
+#include <alia/html/fetch.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace alia { namespace html {
+
+// BATCHED FETCHES
+//
+// Many APIs that serve individual resources (e.g., /api/user/{id}) also
+// offer a way to request many of them at once. batched_fetch() lets
+// components ask for resources one key at a time while the requests actually
+// go out in batches.
+//
+// Keys that are requested through the same adapter during the same event
+// (usually a refresh) are collected into a single batch request. The
+// response to that request is split into individual responses, which complete
+// the signals of the individual callers.
+//
+// Keys are deduplicated within a batch, and the batch request itself goes
+// through html::fetch's usual caching, deduplication and scheduling.
+//
+
+struct batch_adapter
+{
+    // the URL of the batch request - Any occurrences of "{keys}" are replaced
+    // with the keys of the batch, separated by commas. (The keys are inserted
+    // as is, so they should already be URL-safe.)
+    std::string url_template;
+
+    http_method method = http_method::GET;
+
+    http_headers headers;
+
+    // If this is set, it's called to produce the body of the batch request.
+    std::function<blob(std::vector<std::string> const& keys)> encode_body;
+
+    // This splits a (successful) batch response into individual responses.
+    // It must return one response for each key, in the same order as the
+    // keys. (A key that the server didn't know about should get a response
+    // with an appropriate status code.)
+    std::function<std::vector<http_response>(
+        std::vector<std::string> const& keys, http_response const& response)>
+        split_response;
+
+    // the maximum number of keys in a single batch - Larger batches are split
+    // up.
+    std::size_t max_batch_size = 100;
+};
+
+// Fetch the resource with the given key through a batch adapter.
+//
+// If the batch request itself fails (i.e., its status code isn't 2xx), each
+// caller receives the batch response as is.
+//
+// The adapter identifies the batch, so it must outlive any requests made
+// through it. (A static adapter is the natural choice.)
+//
+async_signal<http_response>
+batched_fetch(
+    alia::context ctx,
+    batch_adapter const& adapter,
+    readable<std::string> key);
+
+}} // namespace alia::html
+
+#endif
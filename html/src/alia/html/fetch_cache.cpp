@@ -0,0 +1,256 @@
+#include <alia/html/fetch_cache.hpp>
+
+#include <emscripten/emscripten.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <list>
+#include <unordered_map>
+
+namespace alia { namespace html {
+
+namespace {
+
+struct cache_entry
+{
+    std::string key;
+    std::string url;
+    http_response response;
+    std::string etag;
+    // These are in milliseconds, as given by emscripten_get_now().
+    double fresh_until;
+    double stale_until;
+    std::size_t size;
+};
+
+struct fetch_cache
+{
+    bool enabled = false;
+    fetch_cache_config config;
+    // The entries are kept in order of use, with the most recently used at
+    // the front.
+    std::list<cache_entry> entries;
+    std::unordered_map<std::string, std::list<cache_entry>::iterator> index;
+    std::size_t total_size = 0;
+};
+
+fetch_cache&
+get_fetch_cache()
+{
+    static fetch_cache cache;
+    return cache;
+}
+
+std::string
+to_lower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) {
+        return char(std::tolower(c));
+    });
+    return s;
+}
+
+std::string const*
+find_header(http_headers const& headers, std::string const& name)
+{
+    for (auto const& header : headers)
+    {
+        if (to_lower(header.first) == name)
+            return &header.second;
+    }
+    return nullptr;
+}
+
+void
+remove_entry(fetch_cache& cache, std::list<cache_entry>::iterator entry)
+{
+    cache.total_size -= entry->size;
+    cache.index.erase(entry->key);
+    cache.entries.erase(entry);
+}
+
+void
+enforce_size_limit(fetch_cache& cache)
+{
+    while (cache.total_size > cache.config.max_bytes
+           && !cache.entries.empty())
+    {
+        remove_entry(cache, std::prev(cache.entries.end()));
+    }
+}
+
+// Determine how long (in milliseconds) a response should stay fresh.
+// Returns -1 if the response shouldn't be cached at all.
+double
+get_response_ttl(fetch_cache const& cache, http_response const& response)
+{
+    auto const* cache_control
+        = find_header(response.headers, "cache-control");
+    if (!cache_control)
+        return double(cache.config.default_ttl);
+    auto directives = to_lower(*cache_control);
+    if (directives.find("no-store") != std::string::npos)
+        return -1;
+    if (directives.find("no-cache") != std::string::npos)
+        return 0;
+    auto max_age = directives.find("max-age=");
+    if (max_age != std::string::npos)
+        return std::atof(directives.c_str() + max_age + 8) * 1000;
+    return double(cache.config.default_ttl);
+}
+
+void
+set_expiration(
+    fetch_cache const& cache, cache_entry& entry, double ttl, double now)
+{
+    entry.fresh_until = now + ttl;
+    entry.stale_until
+        = entry.fresh_until + double(cache.config.stale_while_revalidate);
+}
+
+} // namespace
+
+void
+enable_fetch_cache(fetch_cache_config const& config)
+{
+    auto& cache = get_fetch_cache();
+    cache.enabled = true;
+    cache.config = config;
+    for (auto& name : cache.config.key_headers)
+        name = to_lower(name);
+    enforce_size_limit(cache);
+}
+
+void
+disable_fetch_cache()
+{
+    clear_fetch_cache();
+    get_fetch_cache().enabled = false;
+}
+
+void
+clear_fetch_cache()
+{
+    auto& cache = get_fetch_cache();
+    cache.entries.clear();
+    cache.index.clear();
+    cache.total_size = 0;
+}
+
+void
+invalidate_fetch_cache(std::string const& url)
+{
+    auto& cache = get_fetch_cache();
+    auto i = cache.entries.begin();
+    while (i != cache.entries.end())
+    {
+        auto next = std::next(i);
+        if (i->url == url)
+            remove_entry(cache, i);
+        i = next;
+    }
+}
+
+namespace detail {
+
+bool
+is_cacheable(http_request const& request)
+{
+    return get_fetch_cache().enabled && request.method == http_method::GET;
+}
+
+std::string
+get_fetch_cache_key(http_request const& request)
+{
+    auto const& cache = get_fetch_cache();
+    std::string key = to_string(request.method) + " " + request.url;
+    for (auto const& name : cache.config.key_headers)
+    {
+        auto const* value = find_header(request.headers, name);
+        if (value)
+            key += "\n" + name + ": " + *value;
+    }
+    return key;
+}
+
+bool
+look_up_cached_response(std::string const& key, cached_response* result)
+{
+    auto& cache = get_fetch_cache();
+    auto i = cache.index.find(key);
+    if (i == cache.index.end())
+        return false;
+    auto entry = i->second;
+    double now = emscripten_get_now();
+    // Mark the entry as the most recently used.
+    cache.entries.splice(cache.entries.begin(), cache.entries, entry);
+    result->response = entry->response;
+    result->etag = entry->etag;
+    result->freshness = now < entry->fresh_until ? cache_freshness::FRESH
+                        : now < entry->stale_until ? cache_freshness::STALE
+                                                   : cache_freshness::EXPIRED;
+    return true;
+}
+
+void
+store_cached_response(
+    std::string const& key,
+    std::string const& url,
+    http_response const& response)
+{
+    auto& cache = get_fetch_cache();
+    if (!cache.enabled || response.status_code != 200)
+        return;
+
+    auto existing = cache.index.find(key);
+    if (existing != cache.index.end())
+        remove_entry(cache, existing->second);
+
+    double ttl = get_response_ttl(cache, response);
+    std::size_t size = key.size() + std::size_t(response.body.size);
+    if (ttl < 0 || size > cache.config.max_bytes)
+        return;
+
+    cache_entry entry;
+    entry.key = key;
+    entry.url = url;
+    entry.response = response;
+    auto const* etag = find_header(response.headers, "etag");
+    if (etag)
+        entry.etag = *etag;
+    set_expiration(cache, entry, ttl, emscripten_get_now());
+    entry.size = size;
+
+    cache.entries.push_front(std::move(entry));
+    cache.index[key] = cache.entries.begin();
+    cache.total_size += size;
+    enforce_size_limit(cache);
+}
+
+void
+revalidate_cached_response(
+    std::string const& key, http_response const& response)
+{
+    auto& cache = get_fetch_cache();
+    auto i = cache.index.find(key);
+    if (i == cache.index.end())
+        return;
+    auto& entry = *i->second;
+    // The 304 response may come with updated caching headers.
+    http_response updated = entry.response;
+    for (auto const& header : response.headers)
+        updated.headers[header.first] = header.second;
+    double ttl = get_response_ttl(cache, updated);
+    if (ttl < 0)
+    {
+        remove_entry(cache, i->second);
+        return;
+    }
+    entry.response.headers = std::move(updated.headers);
+    set_expiration(cache, entry, ttl, emscripten_get_now());
+}
+
+} // namespace detail
+
+}} // namespace alia::html
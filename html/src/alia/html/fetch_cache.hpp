@@ -0,0 +1,119 @@
+#ifndef ALIA_HTML_FETCH_CACHE_HPP
+#define ALIA_HTML_FETCH_CACHE_HPP
+
+#include <alia/html/fetch.hpp>
+
+#include <string>
+#include <vector>
+
+namespace alia { namespace html {
+
+// FETCH CACHE
+//
+// html::fetch can keep successful GET responses in an in-memory cache, so
+// that remounted components (or independent call sites) don't download the
+// same data again.
+//
+// Cached responses are served according to their age:
+//
+// - While fresh, they're served without touching the network.
+//
+// - Once stale (but within the stale-while-revalidate window), they're served
+//   immediately and also revalidated in the background. If the body changed,
+//   the fetch signal is updated with the new response.
+//
+// - After that, they're revalidated before being served. (If the server
+//   responds with 304 Not Modified, the cached body is reused.)
+//
+// Revalidation uses the ETag of the cached response (via If-None-Match) when
+// there is one. The server's Cache-Control header is respected for 'no-store',
+// 'no-cache' and 'max-age'.
+//
+// Cache entries are keyed by the method and URL of the request and the values
+// of the request headers listed in the cache configuration. Bodies are shared
+// with the responses handed out, so caching them doesn't copy anything.
+//
+// The cache is disabled by default.
+//
+
+struct fetch_cache_config
+{
+    // the maximum total size (in bytes) of the cached responses - The least
+    // recently used responses are evicted to stay under this.
+    std::size_t max_bytes = 16 * 1024 * 1024;
+
+    // how long responses stay fresh, when the server doesn't say
+    millisecond_count default_ttl = 60000;
+
+    // how long after going stale a response can still be served while it's
+    // revalidated in the background
+    millisecond_count stale_while_revalidate = 300000;
+
+    // the request headers that distinguish otherwise identical requests
+    std::vector<std::string> key_headers
+        = {"Accept", "Accept-Language", "Authorization"};
+};
+
+// Enable the fetch cache (or change its configuration).
+void
+enable_fetch_cache(fetch_cache_config const& config = fetch_cache_config());
+
+// Disable the fetch cache. This also clears it.
+void
+disable_fetch_cache();
+
+// Remove all responses from the fetch cache.
+void
+clear_fetch_cache();
+
+// Remove any cached responses for the given URL.
+void
+invalidate_fetch_cache(std::string const& url);
+
+namespace detail {
+
+enum class cache_freshness
+{
+    FRESH,
+    STALE,
+    EXPIRED
+};
+
+struct cached_response
+{
+    http_response response;
+    std::string etag;
+    cache_freshness freshness;
+};
+
+// Is the given request eligible for caching?
+bool
+is_cacheable(http_request const& request);
+
+std::string
+get_fetch_cache_key(http_request const& request);
+
+// Look up the cached response for the given key.
+// Returns false if there's no usable response in the cache.
+bool
+look_up_cached_response(std::string const& key, cached_response* result);
+
+// Record a response that was received from the network.
+void
+store_cached_response(
+    std::string const& key,
+    std::string const& url,
+    http_response const& response);
+
+// Record that the server confirmed that the cached response for the given
+// key is still valid (i.e., it responded with 304 Not Modified).
+// 'response' is the 304 response itself.
+void
+revalidate_cached_response(
+    std::string const& key, http_response const& response);
+
+} // namespace detail
+
+}} // namespace alia::html
+
+#endif
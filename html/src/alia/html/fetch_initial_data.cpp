@@ -0,0 +1,172 @@
+#include <alia/html/fetch_initial_data.hpp>
+
+#include <alia/html/json_view.hpp>
+#include <alia/html/wire.hpp>
+
+#include <emscripten/emscripten.h>
+#include <emscripten/val.h>
+
+#include <algorithm>
+#include <cctype>
+#include <memory>
+#include <unordered_map>
+
+namespace alia { namespace html {
+
+namespace {
+
+struct initial_response
+{
+    http_response response;
+    // Has the response been served? (It's discarded at the end of the pass.)
+    bool claimed = false;
+};
+
+struct initial_data
+{
+    // keyed by the method and URL of the request
+    std::unordered_map<std::string, initial_response> responses;
+    bool discard_scheduled = false;
+};
+
+initial_data&
+get_initial_data()
+{
+    static initial_data data;
+    return data;
+}
+
+std::string
+get_initial_data_key(http_method method, std::string const& url)
+{
+    return to_string(method) + " " + url;
+}
+
+void
+discard_claimed_responses(void*)
+{
+    auto& data = get_initial_data();
+    data.discard_scheduled = false;
+    for (auto i = data.responses.begin(); i != data.responses.end();)
+    {
+        if (i->second.claimed)
+            i = data.responses.erase(i);
+        else
+            ++i;
+    }
+}
+
+std::string
+to_lower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) {
+        return char(std::tolower(c));
+    });
+    return s;
+}
+
+http_response
+parse_initial_response(blob const& payload, json_view const& entry)
+{
+    if (entry.type() != json_type::OBJECT)
+        throw exception("invalid initial data entry");
+
+    http_response response;
+    auto status = entry["status"];
+    response.status_code = status.exists() ? int(status.as_number()) : 200;
+
+    entry["headers"].for_each_member(
+        [&](std::string_view raw_name, json_view const& value) {
+            response.headers[to_lower(unescape_json_string(raw_name))]
+                = value.as_string();
+        });
+
+    if (auto json = entry["json"]; json.exists())
+    {
+        // Point straight into the payload (and share ownership of it).
+        auto raw = json.raw();
+        response.body = blob{raw.data(), raw.size(), payload.ownership};
+    }
+    else if (auto base64 = entry["body_base64"]; base64.exists())
+    {
+        // The wire format's storage encoding is plain base64.
+        response.body = wire_from_storage_string(base64.as_string());
+        if (!response.body.data && !base64.as_string().empty())
+            throw exception("invalid base64 in initial data");
+    }
+    else if (auto body = entry["body"]; body.exists())
+    {
+        response.body = to_blob(body.as_string());
+    }
+    return response;
+}
+
+} // namespace
+
+bool
+load_initial_fetch_data(char const* element_id)
+{
+    emscripten::val document = emscripten::val::global("document");
+    emscripten::val element = document.call<emscripten::val>(
+        "getElementById", std::string(element_id));
+    if (element.isNull())
+        return false;
+    auto text = std::make_shared<std::string>(
+        element["textContent"].as<std::string>());
+    element.call<void>("remove");
+    add_initial_fetch_data(blob{text->data(), text->size(), text});
+    return true;
+}
+
+void
+add_initial_fetch_data(blob const& payload)
+{
+    auto root = index_json(payload);
+    if (root.type() != json_type::OBJECT)
+        throw exception("initial data must be a JSON object");
+    root.for_each_member(
+        [&](std::string_view raw_key, json_view const& entry) {
+            auto key = unescape_json_string(raw_key);
+            auto space = key.find(' ');
+            if (space == std::string::npos || space == 0)
+                throw exception("invalid initial data key: " + key);
+            get_initial_data().responses[key]
+                = initial_response{parse_initial_response(payload, entry)};
+        });
+}
+
+void
+add_initial_fetch_response(
+    http_method method, std::string const& url, http_response response)
+{
+    get_initial_data().responses[get_initial_data_key(method, url)]
+        = initial_response{std::move(response)};
+}
+
+namespace detail {
+
+bool
+take_initial_fetch_response(
+    http_request const& request, http_response* response)
+{
+    auto& data = get_initial_data();
+    // This is the common case, so it should be cheap.
+    if (data.responses.empty())
+        return false;
+    auto entry = data.responses.find(
+        get_initial_data_key(request.method, request.url));
+    if (entry == data.responses.end())
+        return false;
+    *response = entry->second.response;
+    entry->second.claimed = true;
+    if (!data.discard_scheduled)
+    {
+        data.discard_scheduled = true;
+        emscripten_async_call(discard_claimed_responses, nullptr, 0);
+    }
+    return true;
+}
+
+} // namespace detail
+
+}} // namespace alia::html
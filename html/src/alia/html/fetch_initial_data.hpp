@@ -0,0 +1,69 @@
+#ifndef ALIA_HTML_FETCH_INITIAL_DATA_HPP
+#define ALIA_HTML_FETCH_INITIAL_DATA_HPP
+
+#include <alia/html/fetch.hpp>
+
+#include <string>
+
+namespace alia { namespace html {
+
+// INITIAL DATA
+//
+// When the server already knows the responses that the app will request at
+// startup, it can embed them in the page, and html::fetch serves the first
+// matching requests from them without going to the network:
+//
+//   <script type="application/json" id="alia-initial-data">
+//   {
+//       "GET /api/countries": {
+//           "status": 200,
+//           "headers": {"content-type": "application/json"},
+//           "json": [{"code": "us", "name": "United States"}]
+//       },
+//       "GET /api/motd": {"body": "Hello!"},
+//       "GET /api/logo": {"body_base64": "iVBORw0KGgo..."}
+//   }
+//   </script>
+//
+// Each entry is keyed by the method and URL of the request. (Other aspects of
+// the request, like headers, aren't considered.) Its body can be given as a
+// string ("body"), as base64 for binary data ("body_base64") or, for JSON
+// responses, as the JSON itself ("json"). JSON bodies are served directly
+// from the payload without being copied. "status" defaults to 200. (As with
+// any inline script, a "</script>" in the payload must be escaped, e.g., as
+// "<\/script>".)
+//
+// An entry is discarded once it's been served, so later requests go to the
+// network as usual. (All requests for it that are issued in the same pass
+// (e.g., by the initial render) are served from it.) If the fetch cache is
+// enabled, served entries are also stored in it.
+//
+
+// Load the initial data from the script element with the given ID.
+// The element is removed from the document once it's loaded.
+// Returns false if there's no such element.
+// This throws an alia::exception if the payload is malformed.
+bool
+load_initial_fetch_data(char const* element_id = "alia-initial-data");
+
+// Load initial data from a payload in the above format.
+void
+add_initial_fetch_data(blob const& payload);
+
+// Add a single initial response.
+void
+add_initial_fetch_response(
+    http_method method, std::string const& url, http_response response);
+
+namespace detail {
+
+// If there's an initial response for the given request, claim it.
+bool
+take_initial_fetch_response(
+    http_request const& request, http_response* response);
+
+} // namespace detail
+
+}} // namespace alia::html
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef ALIA_HTML_FETCH_JSON_HPP
+#define ALIA_HTML_FETCH_JSON_HPP
+
+#include <alia/html/fetch.hpp>
+#include <alia/html/worker_pool.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <exception>
+#include <optional>
+#include <type_traits>
+
+namespace alia { namespace html {
+
+// DECODED FETCHES
+//
+// fetch_decoded() fetches a response and decodes it into a C++ value in the
+// background (see worker_pool.hpp), so that decoding large payloads doesn't
+// block the main thread. The response body is shared with the worker rather
+// than copied.
+//
+// fetch_json() is the common case of decoding JSON via nlohmann::json. (This
+// header is the only part of alia/HTML that requires nlohmann/json.)
+//
+
+namespace detail {
+
+struct decoded_fetch_data : noncopyable
+{
+    fetch_handle fetch;
+    // This is replaced whenever the request changes, so that decodings that
+    // are still in progress can tell if they're still wanted.
+    std::shared_ptr<int> token = std::make_shared<int>();
+};
+
+inline void
+abandon_decoded_fetch(decoded_fetch_data& data)
+{
+    data.fetch.reset();
+    data.token = std::make_shared<int>();
+}
+
+template<class Decoder>
+auto
+invoke_decoder(
+    Decoder& decoder,
+    http_request const& request,
+    http_response const& response)
+{
+    if constexpr (std::is_invocable_v<Decoder&, http_response const&>)
+        return decoder(response);
+    else
+        return decoder(request, response);
+}
+
+} // namespace detail
+
+// Fetch the response to 'request' and decode it via 'decoder', which is
+// invoked (on a worker thread, if available) as either 'decoder(response)' or
+// 'decoder(request, response)' and must return a Value. If it throws, the
+// signal fails with that exception.
+template<class Value, class Decoder>
+async_signal<Value>
+fetch_decoded(
+    alia::context ctx, readable<http_request> request, Decoder decoder)
+{
+    auto& data = get_cached_data<detail::decoded_fetch_data>(ctx);
+
+    refresh_handler(ctx, [&](auto ctx) {
+        if (!signal_has_value(request))
+            detail::abandon_decoded_fetch(data);
+    });
+
+    return async<Value>(
+        ctx,
+        [&](auto ctx, auto reporter, http_request const& request) {
+            detail::abandon_decoded_fetch(data);
+            std::weak_ptr<int> token = data.token;
+            data.fetch = launch_fetch(
+                request,
+                [reporter, decoder, token, request](
+                    http_response const& response) {
+                    if (token.expired())
+                        return;
+                    auto result = std::make_shared<std::optional<Value>>();
+                    auto error = std::make_shared<std::exception_ptr>();
+                    run_in_background(
+                        [request, response, decoder, result, error]() mutable {
+                            try
+                            {
+                                result->emplace(detail::invoke_decoder(
+                                    decoder, request, response));
+                            }
+                            catch (...)
+                            {
+                                *error = std::current_exception();
+                            }
+                        },
+                        // The response is captured here too, so that it's
+                        // released on the main thread.
+                        [response, reporter, result, error, token]() {
+                            if (token.expired())
+                                return;
+                            if (*result)
+                                reporter.report_success(std::move(**result));
+                            else
+                                reporter.report_failure(*error);
+                        });
+                });
+        },
+        request);
+}
+
+// Fetch the response to 'request' and decode its body as JSON into a Value
+// (via nlohmann::json's conversions). Responses with non-2xx status codes
+// fail with an http_error.
+template<class Value>
+async_signal<Value>
+fetch_json(alia::context ctx, readable<http_request> request)
+{
+    return fetch_decoded<Value>(
+        ctx,
+        request,
+        [](http_request const& request,
+           http_response const& response) -> Value {
+            if (response.status_code < 200 || response.status_code >= 300)
+                throw http_error{request, response};
+            auto const& body = response.body;
+            return nlohmann::json::parse(body.data, body.data + body.size)
+                .template get<Value>();
+        });
+}
+
+}} // namespace alia::html
+
+#endif
@@ -0,0 +1,88 @@
+#include <alia/html/fetch_latency.hpp>
+
+#include <cmath>
+#include <unordered_map>
+
+namespace alia { namespace html {
+
+namespace {
+
+// Bucket i covers latencies in [2^(i/4), 2^((i+1)/4)) milliseconds, so the
+// last bucket tops out at just over a minute.
+unsigned const bucket_count = 64;
+
+// Percentiles aren't reported until an endpoint has this many samples.
+double const minimum_samples = 16;
+
+// When an endpoint accumulates this many samples, they're all halved.
+double const decay_threshold = 1024;
+
+struct latency_histogram
+{
+    double counts[bucket_count] = {};
+    double total = 0;
+};
+
+std::unordered_map<std::string, latency_histogram> histograms;
+
+std::string
+get_endpoint(http_request const& request)
+{
+    return to_string(request.method) + " "
+           + request.url.substr(0, request.url.find_first_of("?#"));
+}
+
+unsigned
+get_bucket(double latency)
+{
+    if (latency < 1)
+        return 0;
+    auto bucket = unsigned(std::log2(latency) * 4);
+    return bucket < bucket_count ? bucket : bucket_count - 1;
+}
+
+} // namespace
+
+bool
+get_fetch_latency_percentile(
+    http_request const& request,
+    double percentile,
+    millisecond_count* latency)
+{
+    auto i = histograms.find(get_endpoint(request));
+    if (i == histograms.end() || i->second.total < minimum_samples)
+        return false;
+    auto const& histogram = i->second;
+    double threshold = histogram.total * percentile;
+    double accumulated = 0;
+    unsigned bucket = 0;
+    for (; bucket != bucket_count - 1; ++bucket)
+    {
+        accumulated += histogram.counts[bucket];
+        if (accumulated >= threshold)
+            break;
+    }
+    // Report the upper bound of the bucket.
+    *latency = millisecond_count(std::ceil(std::exp2((bucket + 1) / 4.)));
+    return true;
+}
+
+namespace detail {
+
+void
+record_fetch_latency(http_request const& request, double latency)
+{
+    auto& histogram = histograms[get_endpoint(request)];
+    histogram.counts[get_bucket(latency)] += 1;
+    histogram.total += 1;
+    if (histogram.total >= decay_threshold)
+    {
+        for (auto& count : histogram.counts)
+            count /= 2;
+        histogram.total /= 2;
+    }
+}
+
+} // namespace detail
+
+}} // namespace alia::html
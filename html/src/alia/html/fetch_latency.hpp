@@ -0,0 +1,37 @@
+#ifndef ALIA_HTML_FETCH_LATENCY_HPP
+#define ALIA_HTML_FETCH_LATENCY_HPP
+
+#include <alia/html/fetch.hpp>
+
+namespace alia { namespace html {
+
+// FETCH LATENCY TRACKING
+//
+// The fetch layer records the latency of every response in a histogram per
+// endpoint. (An endpoint is a method plus a URL without its query string.)
+// Hedging policies use these to decide when to send duplicate requests.
+//
+// The histograms have logarithmic buckets (four per doubling), so
+// percentiles are accurate to within about 20%. Old samples decay as new ones
+// arrive, so the histograms follow changes in server behavior.
+//
+
+// Get the latency (in milliseconds) at the given percentile (in the range
+// [0, 1]) for the endpoint of the given request.
+// Returns false if there aren't enough samples for that endpoint yet.
+bool
+get_fetch_latency_percentile(
+    http_request const& request,
+    double percentile,
+    millisecond_count* latency);
+
+namespace detail {
+
+void
+record_fetch_latency(http_request const& request, double latency);
+
+} // namespace detail
+
+}} // namespace alia::html
+
+#endif
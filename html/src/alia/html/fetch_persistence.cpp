@@ -0,0 +1,213 @@
+#include <alia/html/fetch_persistence.hpp>
+
+#include <alia/html/storage.hpp>
+
+#include <emscripten/fetch.h>
+#include <emscripten/val.h>
+
+#include <cstring>
+#include <map>
+#include <sstream>
+
+namespace alia { namespace html {
+
+namespace {
+
+char const* const manifest_key = "alia-fetch-persistence";
+
+struct manifest_entry
+{
+    std::uint64_t size = 0;
+    // the time of last use, in milliseconds since the epoch
+    double last_used = 0;
+};
+
+struct persistent_cache
+{
+    persistent_fetch_cache_config config;
+    bool loaded = false;
+    // Entries are keyed by their paths.
+    std::map<std::string, manifest_entry> entries;
+    std::uint64_t total_size = 0;
+};
+
+persistent_cache&
+get_persistent_cache()
+{
+    static persistent_cache cache;
+    return cache;
+}
+
+// The manifest is stored as lines of the form '<size> <last_used> <path>'.
+
+void
+load_manifest(persistent_cache& cache)
+{
+    if (cache.loaded)
+        return;
+    cache.loaded = true;
+    auto storage = local_storage();
+    if (!storage.has_item(manifest_key))
+        return;
+    std::istringstream stream(storage.get_item(manifest_key));
+    manifest_entry entry;
+    std::string path;
+    while (stream >> entry.size >> entry.last_used && stream.get() == ' '
+           && std::getline(stream, path))
+    {
+        cache.entries[path] = entry;
+        cache.total_size += entry.size;
+    }
+}
+
+void
+save_manifest(persistent_cache const& cache)
+{
+    std::ostringstream stream;
+    stream.precision(17);
+    for (auto const& entry : cache.entries)
+    {
+        stream << entry.second.size << " " << entry.second.last_used << " "
+               << entry.first << "\n";
+    }
+    local_storage().set_item(manifest_key, stream.str());
+}
+
+double
+get_current_time()
+{
+    return emscripten::val::global("Date").call<double>("now");
+}
+
+void
+close_fetch(emscripten_fetch_t* fetch)
+{
+    emscripten_fetch_close(fetch);
+}
+
+void
+delete_persisted_response(std::string const& path)
+{
+    emscripten_fetch_attr_t attr;
+    emscripten_fetch_attr_init(&attr);
+    std::strcpy(attr.requestMethod, "EM_IDB_DELETE");
+    attr.attributes = EMSCRIPTEN_FETCH_PERSIST_FILE;
+    attr.destinationPath = path.c_str();
+    attr.onsuccess = close_fetch;
+    attr.onerror = close_fetch;
+    emscripten_fetch(&attr, path.c_str());
+}
+
+void
+remove_entry(
+    persistent_cache& cache,
+    std::map<std::string, manifest_entry>::iterator entry)
+{
+    delete_persisted_response(entry->first);
+    cache.total_size -= entry->second.size;
+    cache.entries.erase(entry);
+}
+
+// Evict the least recently used entries until the cache is within its quota.
+// 'keep' is exempt.
+void
+enforce_quota(persistent_cache& cache, std::string const& keep)
+{
+    while (cache.total_size > cache.config.quota_bytes)
+    {
+        auto oldest = cache.entries.end();
+        for (auto i = cache.entries.begin(); i != cache.entries.end(); ++i)
+        {
+            if (i->first != keep
+                && (oldest == cache.entries.end()
+                    || i->second.last_used < oldest->second.last_used))
+            {
+                oldest = i;
+            }
+        }
+        if (oldest == cache.entries.end())
+            break;
+        remove_entry(cache, oldest);
+    }
+}
+
+} // namespace
+
+void
+configure_persistent_fetch_cache(persistent_fetch_cache_config const& config)
+{
+    auto& cache = get_persistent_cache();
+    load_manifest(cache);
+    cache.config = config;
+    enforce_quota(cache, std::string());
+    save_manifest(cache);
+}
+
+void
+clear_persistent_fetch_cache()
+{
+    auto& cache = get_persistent_cache();
+    load_manifest(cache);
+    while (!cache.entries.empty())
+        remove_entry(cache, cache.entries.begin());
+    save_manifest(cache);
+}
+
+namespace detail {
+
+std::string
+get_persistent_path(http_request const& request)
+{
+    // The version is escaped so that the first '/' after it always marks
+    // where the URL begins.
+    std::string path = "alia-fetch/";
+    for (char c : request.persistence.version)
+    {
+        if (c == '/')
+            path += "%2F";
+        else if (c == '%')
+            path += "%25";
+        else
+            path += c;
+    }
+    return path + "/" + request.url;
+}
+
+void
+record_persistent_response(http_request const& request, std::uint64_t size)
+{
+    auto& cache = get_persistent_cache();
+    load_manifest(cache);
+
+    auto path = get_persistent_path(request);
+
+    // Discard any responses for the same URL that were stored under other
+    // versions.
+    auto i = cache.entries.begin();
+    while (i != cache.entries.end())
+    {
+        auto next = std::next(i);
+        auto const& other = i->first;
+        auto version_end = other.find('/', std::strlen("alia-fetch/"));
+        if (other != path && version_end != std::string::npos
+            && other.compare(version_end + 1, std::string::npos, request.url)
+                   == 0)
+        {
+            remove_entry(cache, i);
+        }
+        i = next;
+    }
+
+    auto& entry = cache.entries[path];
+    cache.total_size -= entry.size;
+    entry.size = size;
+    entry.last_used = get_current_time();
+    cache.total_size += size;
+
+    enforce_quota(cache, path);
+    save_manifest(cache);
+}
+
+} // namespace detail
+
+}} // namespace alia::html
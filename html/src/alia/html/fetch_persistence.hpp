@@ -0,0 +1,51 @@
+#ifndef ALIA_HTML_FETCH_PERSISTENCE_HPP
+#define ALIA_HTML_FETCH_PERSISTENCE_HPP
+
+#include <alia/html/fetch.hpp>
+
+#include <cstdint>
+#include <string>
+
+namespace alia { namespace html {
+
+// PERSISTENT FETCH CACHE
+//
+// Requests with a persistence policy (see http_request) have their responses
+// stored in IndexedDB through Emscripten's fetch layer.
+//
+// The total size of the persisted responses is kept within a quota by
+// evicting the least recently used ones. The bookkeeping for this lives in
+// local storage, since IndexedDB itself can't tell us when entries were last
+// used.
+//
+// Persisted responses are keyed by URL and version. Storing a response under
+// a new version discards the ones stored under other versions.
+//
+
+struct persistent_fetch_cache_config
+{
+    std::uint64_t quota_bytes = 64 * 1024 * 1024;
+};
+
+void
+configure_persistent_fetch_cache(persistent_fetch_cache_config const& config);
+
+// Discard all persisted responses.
+void
+clear_persistent_fetch_cache();
+
+namespace detail {
+
+// Get the path under which the response to the given request is persisted.
+std::string
+get_persistent_path(http_request const& request);
+
+// Record that the response to the given request was persisted (or used).
+void
+record_persistent_response(http_request const& request, std::uint64_t size);
+
+} // namespace detail
+
+}} // namespace alia::html
+
+#endif
@@ -0,0 +1,278 @@
+#include <alia/html/fetch_stream.hpp>
+
+#include <emscripten/emscripten.h>
+#include <emscripten/fetch.h>
+
+#include <cstring>
+#include <deque>
+#include <vector>
+
+namespace alia { namespace html {
+
+namespace detail {
+
+struct fetch_stream_state
+    : std::enable_shared_from_this<fetch_stream_state>
+{
+    // the component data that owns this stream - This is cleared when the
+    // stream is abandoned, at which point nothing else should be done.
+    fetch_stream_data* owner = nullptr;
+
+    alia::system* system = nullptr;
+
+    // This is null once the fetch is finished.
+    emscripten_fetch_t* fetch = nullptr;
+
+    stream_consumer consumer;
+    fetch_stream_options options;
+
+    // the chunks that haven't been delivered yet
+    std::deque<std::vector<char>> buffer;
+
+    fetch_stream_progress progress;
+    bool received_all = false;
+
+    bool delivery_scheduled = false;
+};
+
+static void
+deliver_chunks(void* arg);
+
+static void
+schedule_delivery(fetch_stream_state& state)
+{
+    if (!state.delivery_scheduled)
+    {
+        state.delivery_scheduled = true;
+        emscripten_async_call(
+            deliver_chunks,
+            new std::shared_ptr<fetch_stream_state>(state.shared_from_this()),
+            0);
+    }
+}
+
+static void
+deliver_chunks(void* arg)
+{
+    std::unique_ptr<std::shared_ptr<fetch_stream_state>> holder(
+        reinterpret_cast<std::shared_ptr<fetch_stream_state>*>(arg));
+    auto& state = **holder;
+    state.delivery_scheduled = false;
+    if (!state.owner)
+        return;
+
+    auto& progress = state.progress;
+    double start_time = emscripten_get_now();
+    while (!state.buffer.empty()
+           && emscripten_get_now() - start_time
+                  < double(state.options.delivery_budget))
+    {
+        std::vector<char> chunk = std::move(state.buffer.front());
+        state.buffer.pop_front();
+        progress.bytes_buffered -= chunk.size();
+        if (state.consumer)
+            state.consumer(chunk.data(), chunk.size());
+        progress.bytes_delivered += chunk.size();
+    }
+
+    if (state.buffer.empty())
+        progress.complete = state.received_all && !progress.failed;
+    else
+        schedule_delivery(state);
+
+    state.owner->progress.set(progress);
+    refresh_system_when_visible(*state.system);
+}
+
+static void
+handle_stream_progress(emscripten_fetch_t* fetch)
+{
+    auto* state = reinterpret_cast<fetch_stream_state*>(fetch->userData);
+    if (!state)
+        return;
+    auto& progress = state->progress;
+    progress.status_code = fetch->status;
+    progress.bytes_received = fetch->dataOffset + fetch->numBytes;
+    progress.total_bytes = fetch->totalBytes;
+    // The chunk is only valid during this callback, so it has to be copied.
+    if (fetch->numBytes != 0)
+    {
+        state->buffer.emplace_back(
+            fetch->data, fetch->data + std::size_t(fetch->numBytes));
+        progress.bytes_buffered += fetch->numBytes;
+    }
+    schedule_delivery(*state);
+}
+
+static void
+handle_stream_completion(emscripten_fetch_t* fetch, bool failed)
+{
+    auto* state = reinterpret_cast<fetch_stream_state*>(fetch->userData);
+    if (!state)
+        return;
+    state->progress.status_code = fetch->status;
+    state->progress.failed = failed;
+    state->received_all = true;
+    state->fetch = nullptr;
+    emscripten_fetch_close(fetch);
+    schedule_delivery(*state);
+}
+
+static void
+handle_stream_success(emscripten_fetch_t* fetch)
+{
+    handle_stream_completion(fetch, false);
+}
+
+static void
+handle_stream_error(emscripten_fetch_t* fetch)
+{
+    handle_stream_completion(fetch, true);
+}
+
+static void
+abandon_stream(fetch_stream_data& data)
+{
+    if (!data.state)
+        return;
+    auto& state = *data.state;
+    state.owner = nullptr;
+    state.consumer = nullptr;
+    state.buffer.clear();
+    if (state.fetch)
+    {
+        // emscripten_fetch_close invokes the error handler for fetches that
+        // are still in progress, so detach the state first.
+        state.fetch->userData = nullptr;
+        emscripten_fetch_close(state.fetch);
+        state.fetch = nullptr;
+    }
+    data.state.reset();
+}
+
+fetch_stream_data::~fetch_stream_data()
+{
+    abandon_stream(*this);
+}
+
+static void
+start_stream(
+    fetch_stream_data& data, alia::system& system, http_request const& request)
+{
+    auto state = std::make_shared<fetch_stream_state>();
+    state->owner = &data;
+    state->system = &system;
+
+    emscripten_fetch_attr_t attr;
+    emscripten_fetch_attr_init(&attr);
+
+    // Note that the body isn't loaded into memory; we only see it in chunks.
+    attr.attributes = EMSCRIPTEN_FETCH_STREAM_DATA;
+
+    attr.onprogress = handle_stream_progress;
+    attr.onsuccess = handle_stream_success;
+    attr.onerror = handle_stream_error;
+
+    std::vector<char const*> headers;
+    headers.reserve(request.headers.size() * 2 + 1);
+    for (auto const& h : request.headers)
+    {
+        headers.push_back(h.first.c_str());
+        headers.push_back(h.second.c_str());
+    }
+    headers.push_back(0);
+    attr.requestHeaders = &headers[0];
+
+    attr.requestData = request.body.data;
+    attr.requestDataSize = request.body.size;
+
+    std::strcpy(attr.requestMethod, to_string(request.method).c_str());
+
+    attr.userData = state.get();
+    state->fetch = emscripten_fetch(&attr, request.url.c_str());
+
+    data.state = std::move(state);
+    data.progress.set(fetch_stream_progress());
+}
+
+} // namespace detail
+
+fetch_stream_signal
+fetch_stream(
+    html::context ctx,
+    readable<http_request> request,
+    stream_consumer consumer,
+    fetch_stream_options const& options)
+{
+    auto& data = get_cached_data<detail::fetch_stream_data>(ctx);
+
+    refresh_handler(ctx, [&](auto ctx) {
+        data.progress.refresh_container(get_active_component_container(ctx));
+        refresh_signal_view(
+            data.request_id,
+            request,
+            [&](http_request const& new_request) {
+                detail::abandon_stream(data);
+                detail::start_stream(
+                    data, get<alia::system_tag>(ctx), new_request);
+            },
+            [&]() { detail::abandon_stream(data); });
+        if (data.state)
+        {
+            data.state->consumer = std::move(consumer);
+            data.state->options = options;
+        }
+    });
+
+    return fetch_stream_signal(&data);
+}
+
+void
+ndjson_splitter::emit(std::string_view line)
+{
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+    if (!line.empty())
+        handler_(line);
+}
+
+void
+ndjson_splitter::feed(char const* data, std::size_t size)
+{
+    char const* end = data + size;
+    char const* line_start = data;
+    while (true)
+    {
+        auto* newline = static_cast<char const*>(
+            std::memchr(line_start, '\n', std::size_t(end - line_start)));
+        if (!newline)
+            break;
+        if (partial_.empty())
+        {
+            // The common case: the line is entirely within this chunk, so we
+            // can hand it out directly.
+            emit(std::string_view(
+                line_start, std::size_t(newline - line_start)));
+        }
+        else
+        {
+            partial_.append(line_start, newline);
+            emit(partial_);
+            partial_.clear();
+        }
+        line_start = newline + 1;
+    }
+    partial_.append(line_start, end);
+}
+
+void
+ndjson_splitter::finish()
+{
+    if (!partial_.empty())
+    {
+        emit(partial_);
+        partial_.clear();
+    }
+}
+
+}} // namespace alia::html
@@ -0,0 +1,147 @@
+#ifndef ALIA_HTML_FETCH_STREAM_HPP
+#define ALIA_HTML_FETCH_STREAM_HPP
+
+#include <alia/html/context.hpp>
+#include <alia/html/fetch.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace alia { namespace html {
+
+// STREAMING FETCH
+//
+// fetch_stream() delivers the response body incrementally to a C++ consumer,
+// as it arrives, rather than loading the whole thing into memory.
+//
+// Chunks are delivered outside of refreshes, in slices that are limited by a
+// time budget, so that processing a fast download doesn't starve input
+// handling or rendering. Chunks that don't fit in the current slice stay
+// buffered until the next one. (Note that the browser gives us no way to
+// pause the download itself, so a consumer that is consistently slower than
+// the network will see the buffer grow. The progress signal reports how much
+// is buffered.) The app is refreshed once per slice, so that views can render
+// whatever the consumer has accumulated.
+//
+// This relies on Emscripten's EMSCRIPTEN_FETCH_STREAM_DATA mode, which needs
+// a browser (or Emscripten fetch backend) that supports streaming.
+//
+
+struct fetch_stream_progress
+{
+    // This is 0 until the response headers arrive.
+    int status_code = 0;
+    std::uint64_t bytes_received = 0;
+    // the total size of the response body, or 0 if it's not known
+    std::uint64_t total_bytes = 0;
+    std::uint64_t bytes_delivered = 0;
+    std::uint64_t bytes_buffered = 0;
+    // Has the entire body been received and delivered?
+    bool complete = false;
+    bool failed = false;
+};
+
+// The consumer is called outside of refreshes, so it should only reference
+// persistent state.
+typedef std::function<void(char const* data, std::size_t size)>
+    stream_consumer;
+
+struct fetch_stream_options
+{
+    // the maximum time spent delivering chunks before yielding to the browser
+    millisecond_count delivery_budget = 8;
+};
+
+namespace detail {
+
+struct fetch_stream_state;
+
+struct fetch_stream_data
+{
+    ~fetch_stream_data();
+
+    captured_id request_id;
+    std::shared_ptr<fetch_stream_state> state;
+    state_storage<fetch_stream_progress> progress;
+};
+
+} // namespace detail
+
+struct fetch_stream_signal
+    : signal<fetch_stream_signal, fetch_stream_progress, read_only_signal>
+{
+    explicit fetch_stream_signal(detail::fetch_stream_data* data)
+        : data_(data)
+    {
+    }
+
+    bool
+    has_value() const override
+    {
+        return data_->state != nullptr;
+    }
+
+    fetch_stream_progress const&
+    read() const override
+    {
+        return data_->progress.get();
+    }
+
+    simple_id<unsigned> const&
+    value_id() const override
+    {
+        id_ = make_id(data_->progress.version());
+        return id_;
+    }
+
+ private:
+    detail::fetch_stream_data* data_;
+    mutable simple_id<unsigned> id_;
+};
+
+// Stream the response to 'request' into 'consumer'.
+// The returned signal carries the progress of the stream. (It has no value
+// while there's no request.) Changing the request aborts the current stream
+// and starts a new one.
+fetch_stream_signal
+fetch_stream(
+    html::context ctx,
+    readable<http_request> request,
+    stream_consumer consumer,
+    fetch_stream_options const& options = fetch_stream_options());
+
+// ndjson_splitter splits a stream of chunks into newline-delimited records
+// (e.g., NDJSON). Lines may end in either LF or CRLF, and blank lines are
+// skipped.
+struct ndjson_splitter
+{
+    typedef std::function<void(std::string_view line)> line_handler;
+
+    explicit ndjson_splitter(line_handler handler)
+        : handler_(std::move(handler))
+    {
+    }
+
+    // Feed in the next chunk of the stream.
+    void
+    feed(char const* data, std::size_t size);
+
+    // Flush out the final line (if the stream didn't end with a newline).
+    void
+    finish();
+
+ private:
+    void
+    emit(std::string_view line);
+
+    line_handler handler_;
+    // the incomplete line left over from previous chunks
+    std::string partial_;
+};
+
+}} // namespace alia::html
+
+#endif
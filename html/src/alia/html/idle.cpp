@@ -0,0 +1,291 @@
+#include <alia/html/idle.hpp>
+
+#include <emscripten/bind.h>
+#include <emscripten/emscripten.h>
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <vector>
+
+namespace alia { namespace html {
+
+double
+idle_deadline::time_remaining() const
+{
+    return (std::max)(0., this->end_time - emscripten_get_now());
+}
+
+namespace {
+
+struct idle_task
+{
+    idle_task_function function;
+    idle_priority priority = idle_priority::NORMAL;
+    // the time by which the task must run, or a negative value if it has no
+    // deadline
+    double deadline = -1;
+    unsigned generation = 1;
+    bool active = false;
+};
+
+// All tasks are allocated out of this pool. Finished and cancelled tasks are
+// returned to the free list, so scheduling a task doesn't require a heap
+// allocation once the pool has grown to the app's steady-state size (beyond
+// whatever the function object itself requires).
+struct idle_task_pool
+{
+    std::vector<idle_task> tasks;
+    std::vector<unsigned> free_list;
+    unsigned active_count = 0;
+
+    idle_task_handle
+    allocate()
+    {
+        unsigned index;
+        if (!free_list.empty())
+        {
+            index = free_list.back();
+            free_list.pop_back();
+        }
+        else
+        {
+            index = unsigned(tasks.size());
+            tasks.emplace_back();
+        }
+        tasks[index].active = true;
+        ++active_count;
+        return idle_task_handle{index, tasks[index].generation};
+    }
+
+    idle_task*
+    lookup(idle_task_handle const& handle)
+    {
+        if (handle.generation == 0 || handle.index >= tasks.size())
+            return nullptr;
+        idle_task& task = tasks[handle.index];
+        return task.active && task.generation == handle.generation ? &task
+                                                                   : nullptr;
+    }
+
+    void
+    release(unsigned index)
+    {
+        idle_task& task = tasks[index];
+        task.function = nullptr;
+        task.active = false;
+        // Skip 0 when wrapping since it's reserved for null handles.
+        if (++task.generation == 0)
+            task.generation = 1;
+        free_list.push_back(index);
+        --active_count;
+    }
+};
+
+struct idle_scheduler
+{
+    idle_task_pool pool;
+
+    // These hold handles to the pending tasks at each priority level.
+    // Cancelled tasks aren't removed from these. Instead, their handles are
+    // detected as stale (and skipped) when they reach the front.
+    std::deque<idle_task_handle> queues[3];
+
+    // the number of idle callbacks that have been requested but haven't yet
+    // arrived
+    unsigned outstanding_callbacks = 0;
+    // the earliest deadline that one of those callbacks will honor
+    double requested_deadline = std::numeric_limits<double>::infinity();
+};
+
+idle_scheduler&
+get_idle_scheduler()
+{
+    static idle_scheduler scheduler;
+    return scheduler;
+}
+
+void
+request_idle_callback(int timeout)
+{
+    EM_ASM(
+        {
+            var run = function(deadline)
+            {
+                Module.idle_callback_proxy(
+                    performance.now() + deadline.timeRemaining(),
+                    deadline.didTimeout);
+            };
+            if (typeof requestIdleCallback !== 'undefined')
+            {
+                requestIdleCallback(run, $0 >= 0 ? {timeout : $0} : {});
+            }
+            else
+            {
+                // Emulate a short idle period after the timeout.
+                setTimeout(function() {
+                    run({
+                        timeRemaining : function() { return 10; },
+                        didTimeout : false
+                    });
+                }, $0 >= 0 ? Math.min($0, 50) : 50);
+            }
+        },
+        timeout);
+}
+
+// Ensure that an idle callback is coming that will honor the earliest deadline
+// of any pending task.
+void
+ensure_idle_callback(idle_scheduler& scheduler)
+{
+    if (scheduler.pool.active_count == 0)
+        return;
+
+    double earliest_deadline = std::numeric_limits<double>::infinity();
+    for (auto const& task : scheduler.pool.tasks)
+    {
+        if (task.active && task.deadline >= 0)
+            earliest_deadline = (std::min)(earliest_deadline, task.deadline);
+    }
+
+    if (scheduler.outstanding_callbacks != 0
+        && scheduler.requested_deadline <= earliest_deadline)
+    {
+        return;
+    }
+
+    int timeout = -1;
+    if (earliest_deadline != std::numeric_limits<double>::infinity())
+    {
+        timeout = int((std::max)(
+            0., std::ceil(earliest_deadline - emscripten_get_now())));
+    }
+    request_idle_callback(timeout);
+    ++scheduler.outstanding_callbacks;
+    scheduler.requested_deadline = earliest_deadline;
+}
+
+void
+run_task(
+    idle_scheduler& scheduler,
+    idle_task_handle handle,
+    idle_deadline const& deadline)
+{
+    idle_task* task = scheduler.pool.lookup(handle);
+    if (!task)
+        return;
+    // Release the slot before running the task since the task might schedule
+    // new ones (which could reallocate the pool).
+    auto function = std::move(task->function);
+    scheduler.pool.release(handle.index);
+    function(deadline);
+}
+
+// Pop the next pending task (in priority order).
+// Returns a null handle if there are no pending tasks.
+idle_task_handle
+pop_next_task(idle_scheduler& scheduler)
+{
+    for (auto& queue : scheduler.queues)
+    {
+        while (!queue.empty())
+        {
+            auto handle = queue.front();
+            queue.pop_front();
+            if (scheduler.pool.lookup(handle))
+                return handle;
+        }
+    }
+    return idle_task_handle();
+}
+
+void
+run_idle_tasks(double end_time, bool did_timeout)
+{
+    auto& scheduler = get_idle_scheduler();
+
+    if (--scheduler.outstanding_callbacks == 0)
+    {
+        scheduler.requested_deadline
+            = std::numeric_limits<double>::infinity();
+    }
+
+    // First, run any tasks whose deadlines have passed, regardless of
+    // priority and regardless of how much idle time we have.
+    double now = emscripten_get_now();
+    std::vector<std::pair<double, idle_task_handle>> overdue;
+    auto& tasks = scheduler.pool.tasks;
+    for (unsigned i = 0; i != tasks.size(); ++i)
+    {
+        if (tasks[i].active && tasks[i].deadline >= 0
+            && tasks[i].deadline <= now)
+        {
+            overdue.emplace_back(
+                tasks[i].deadline,
+                idle_task_handle{i, tasks[i].generation});
+        }
+    }
+    std::sort(
+        overdue.begin(), overdue.end(), [](auto const& a, auto const& b) {
+            return a.first < b.first;
+        });
+    for (auto const& entry : overdue)
+        run_task(scheduler, entry.second, idle_deadline{end_time, true});
+
+    // Then run tasks in priority order for as long as the browser stays idle.
+    idle_deadline deadline{end_time, did_timeout};
+    while (deadline.time_remaining() > 0)
+    {
+        auto handle = pop_next_task(scheduler);
+        if (handle.generation == 0)
+            break;
+        run_task(scheduler, handle, deadline);
+    }
+
+    ensure_idle_callback(scheduler);
+}
+
+} // namespace
+
+EMSCRIPTEN_BINDINGS(idle_callback_proxy)
+{
+    emscripten::function("idle_callback_proxy", &run_idle_tasks);
+};
+
+idle_task_handle
+schedule_idle_task(
+    idle_task_function function, idle_priority priority, int timeout)
+{
+    auto& scheduler = get_idle_scheduler();
+
+    auto handle = scheduler.pool.allocate();
+    idle_task& task = scheduler.pool.tasks[handle.index];
+    task.function = std::move(function);
+    task.priority = priority;
+    task.deadline = timeout >= 0 ? emscripten_get_now() + timeout : -1;
+
+    scheduler.queues[int(priority)].push_back(handle);
+
+    ensure_idle_callback(scheduler);
+
+    return handle;
+}
+
+bool
+is_idle_task_pending(idle_task_handle const& handle)
+{
+    return get_idle_scheduler().pool.lookup(handle) != nullptr;
+}
+
+void
+cancel_idle_task(idle_task_handle& handle)
+{
+    auto& scheduler = get_idle_scheduler();
+    if (scheduler.pool.lookup(handle))
+        scheduler.pool.release(handle.index);
+    handle = idle_task_handle();
+}
+
+}} // namespace alia::html
@@ -0,0 +1,82 @@
+#ifndef ALIA_HTML_IDLE_HPP
+#define ALIA_HTML_IDLE_HPP
+
+#include <functional>
+
+namespace alia { namespace html {
+
+// IDLE-TIME TASKS
+//
+// The following allows non-urgent work (storage flushes, prefetches, cache
+// trims, etc.) to be deferred until the browser is idle, so that it doesn't
+// compete with input handling and rendering.
+//
+// This is built on requestIdleCallback. In browsers that don't support it,
+// tasks are run from a short timeout instead.
+//
+// See
+// https://developer.mozilla.org/en-US/docs/Web/API/Window/requestIdleCallback
+//
+
+enum class idle_priority
+{
+    HIGH,
+    NORMAL,
+    LOW
+};
+
+// An idle_deadline is passed to each task to tell it how much of the current
+// idle period remains. Long-running tasks can use this to split up their
+// work (by rescheduling themselves).
+struct idle_deadline
+{
+    // the time (in emscripten_get_now() terms) at which the idle period ends
+    double end_time = 0;
+
+    // Is the task running because its deadline expired (rather than because
+    // the browser is idle)?
+    bool did_timeout = false;
+
+    // Get the number of milliseconds remaining in the idle period.
+    double
+    time_remaining() const;
+};
+
+typedef std::function<void(idle_deadline const&)> idle_task_function;
+
+// A handle to a scheduled idle task, which can be used to cancel it.
+// A default-constructed handle refers to no task.
+struct idle_task_handle
+{
+    unsigned index = 0;
+    // 0 is never a valid generation, so this also serves as a null flag.
+    unsigned generation = 0;
+};
+
+// Schedule a task to run when the browser is idle.
+//
+// Tasks are run in priority order (and in FIFO order within a priority).
+//
+// If 'timeout' is nonnegative, it specifies a deadline (in milliseconds from
+// now) for the task. If the browser hasn't been idle by then, the task will be
+// run anyway (with did_timeout set), ahead of any other tasks.
+//
+idle_task_handle
+schedule_idle_task(
+    idle_task_function task,
+    idle_priority priority = idle_priority::NORMAL,
+    int timeout = -1);
+
+// Is the given task still waiting to run?
+bool
+is_idle_task_pending(idle_task_handle const& handle);
+
+// Cancel a pending idle task.
+// This is a no-op if the task has already run (or been cancelled).
+// In all cases, the handle is reset.
+void
+cancel_idle_task(idle_task_handle& handle);
+
+}} // namespace alia::html
+
+#endif
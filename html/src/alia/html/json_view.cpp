@@ -0,0 +1,624 @@
+#include <alia/html/json_view.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
+
+namespace alia { namespace html {
+
+namespace {
+
+bool
+is_json_whitespace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+#ifdef __wasm_simd128__
+
+// Does the sixteen-byte chunk at 'p' contain anything that the indexer needs
+// to look at? Within strings, that's quotes and backslashes. Outside them,
+// it's the structural characters.
+bool
+chunk_is_interesting(char const* p, bool in_string)
+{
+    v128_t chunk = wasm_v128_load(p);
+    v128_t hits = wasm_i8x16_eq(chunk, wasm_i8x16_splat('"'));
+    if (in_string)
+    {
+        hits = wasm_v128_or(
+            hits, wasm_i8x16_eq(chunk, wasm_i8x16_splat('\\')));
+    }
+    else
+    {
+        // Setting bit 5 maps '[' onto '{' and ']' onto '}' (and nothing else
+        // onto either).
+        v128_t folded = wasm_v128_or(chunk, wasm_i8x16_splat(0x20));
+        hits = wasm_v128_or(
+            hits,
+            wasm_v128_or(
+                wasm_v128_or(
+                    wasm_i8x16_eq(folded, wasm_i8x16_splat('{')),
+                    wasm_i8x16_eq(folded, wasm_i8x16_splat('}'))),
+                wasm_v128_or(
+                    wasm_i8x16_eq(chunk, wasm_i8x16_splat(',')),
+                    wasm_i8x16_eq(chunk, wasm_i8x16_splat(':')))));
+    }
+    return wasm_v128_any_true(hits);
+}
+
+#endif
+
+// Find the position of the closing quote of the string whose opening quote
+// is at 'position'.
+std::uint32_t
+find_string_end(blob const& document, std::uint32_t position)
+{
+    char const* data = document.data;
+    std::uint32_t i = position + 1;
+    while (i < document.size && data[i] != '"')
+        i += data[i] == '\\' ? 2 : 1;
+    return i;
+}
+
+void
+append_utf8(std::string& out, std::uint32_t code_point)
+{
+    if (code_point < 0x80)
+    {
+        out += char(code_point);
+    }
+    else if (code_point < 0x800)
+    {
+        out += char(0xc0 | (code_point >> 6));
+        out += char(0x80 | (code_point & 0x3f));
+    }
+    else if (code_point < 0x10000)
+    {
+        out += char(0xe0 | (code_point >> 12));
+        out += char(0x80 | ((code_point >> 6) & 0x3f));
+        out += char(0x80 | (code_point & 0x3f));
+    }
+    else
+    {
+        out += char(0xf0 | (code_point >> 18));
+        out += char(0x80 | ((code_point >> 12) & 0x3f));
+        out += char(0x80 | ((code_point >> 6) & 0x3f));
+        out += char(0x80 | (code_point & 0x3f));
+    }
+}
+
+std::uint32_t
+parse_hex4(std::string_view text, std::size_t position)
+{
+    if (position + 4 > text.size())
+        throw exception("invalid JSON string escape");
+    std::uint32_t value = 0;
+    for (std::size_t i = position; i != position + 4; ++i)
+    {
+        char c = text[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9')
+            value |= std::uint32_t(c - '0');
+        else if (c >= 'a' && c <= 'f')
+            value |= std::uint32_t(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F')
+            value |= std::uint32_t(c - 'A' + 10);
+        else
+            throw exception("invalid JSON string escape");
+    }
+    return value;
+}
+
+} // namespace
+
+std::string
+unescape_json_string(std::string_view text)
+{
+    std::string out;
+    out.reserve(text.size());
+    for (std::size_t i = 0; i != text.size(); ++i)
+    {
+        char c = text[i];
+        if (c != '\\')
+        {
+            out += c;
+            continue;
+        }
+        if (++i == text.size())
+            throw exception("invalid JSON string escape");
+        switch (text[i])
+        {
+            case '"':
+            case '\\':
+            case '/':
+                out += text[i];
+                break;
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'n':
+                out += '\n';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'u': {
+                std::uint32_t code_point = parse_hex4(text, i + 1);
+                i += 4;
+                // Combine surrogate pairs.
+                if (code_point >= 0xd800 && code_point < 0xdc00
+                    && i + 2 < text.size() && text[i + 1] == '\\'
+                    && text[i + 2] == 'u')
+                {
+                    std::uint32_t low = parse_hex4(text, i + 3);
+                    if (low >= 0xdc00 && low < 0xe000)
+                    {
+                        code_point = 0x10000 + ((code_point - 0xd800) << 10)
+                                     + (low - 0xdc00);
+                        i += 6;
+                    }
+                }
+                append_utf8(out, code_point);
+                break;
+            }
+            default:
+                throw exception("invalid JSON string escape");
+        }
+    }
+    return out;
+}
+
+json_view
+index_json(blob const& document)
+{
+    if (document.size > std::numeric_limits<std::uint32_t>::max())
+        throw exception("JSON document is too large to index");
+
+    auto index = std::make_shared<detail::json_index>();
+    index->document = document;
+    auto& structurals = index->structurals;
+    // Start with a modest guess (one structural per 64 bytes, up to 256KB of
+    // index) and let the vector grow from there, so the index never starts
+    // out anywhere near the size of the document itself.
+    structurals.reserve(
+        (std::min)(std::size_t(document.size / 64), std::size_t(1) << 16));
+
+    char const* data = document.data;
+    std::uint32_t size = std::uint32_t(document.size);
+    std::vector<std::uint32_t> open_brackets;
+    bool in_string = false;
+    std::uint32_t i = 0;
+    while (i < size)
+    {
+#ifdef __wasm_simd128__
+        if (i + 16 <= size && !chunk_is_interesting(data + i, in_string))
+        {
+            i += 16;
+            continue;
+        }
+#endif
+        char c = data[i];
+        if (in_string)
+        {
+            if (c == '\\')
+                ++i;
+            else if (c == '"')
+                in_string = false;
+        }
+        else
+        {
+            switch (c)
+            {
+                case '"':
+                    in_string = true;
+                    structurals.push_back({i, 0});
+                    break;
+                case '{':
+                case '[':
+                    open_brackets.push_back(std::uint32_t(structurals.size()));
+                    structurals.push_back({i, 0});
+                    break;
+                case '}':
+                case ']': {
+                    char opening = c == '}' ? '{' : '[';
+                    if (open_brackets.empty()
+                        || data[structurals[open_brackets.back()].position]
+                               != opening)
+                    {
+                        throw exception("invalid JSON: mismatched brackets");
+                    }
+                    auto opener = open_brackets.back();
+                    open_brackets.pop_back();
+                    structurals[opener].match
+                        = std::uint32_t(structurals.size());
+                    structurals.push_back({i, opener});
+                    break;
+                }
+                case ':':
+                case ',':
+                    structurals.push_back({i, 0});
+                    break;
+            }
+        }
+        ++i;
+    }
+    if (in_string || !open_brackets.empty())
+        throw exception("invalid JSON: unexpected end of document");
+
+    json_view root;
+    root.index_ = std::move(index);
+    return root.value_at(0, 0);
+}
+
+json_type
+json_view::type() const
+{
+    return type_;
+}
+
+json_view
+json_view::value_at(std::uint32_t position, std::uint32_t next) const
+{
+    auto const& document = index_->document;
+    auto const& structurals = index_->structurals;
+    char const* data = document.data;
+
+    while (position < document.size && is_json_whitespace(data[position]))
+        ++position;
+
+    json_view view;
+    if (position >= document.size)
+        return view;
+    view.index_ = index_;
+    view.position_ = position;
+
+    if (next < structurals.size() && structurals[next].position == position)
+    {
+        switch (data[position])
+        {
+            case '{':
+                view.type_ = json_type::OBJECT;
+                break;
+            case '[':
+                view.type_ = json_type::ARRAY;
+                break;
+            case '"':
+                view.type_ = json_type::STRING;
+                break;
+            default:
+                // a comma, colon or closing bracket, so there's no value
+                return json_view();
+        }
+        view.structural_ = next;
+        return view;
+    }
+
+    switch (data[position])
+    {
+        case 'n':
+            view.type_ = json_type::NULL_;
+            break;
+        case 't':
+        case 'f':
+            view.type_ = json_type::BOOLEAN;
+            break;
+        default:
+            view.type_ = json_type::NUMBER;
+            break;
+    }
+    view.structural_ = next;
+    return view;
+}
+
+json_view
+json_view::value_after(std::uint32_t structural) const
+{
+    return value_at(
+        index_->structurals[structural].position + 1, structural + 1);
+}
+
+std::uint32_t
+json_view::next_structural() const
+{
+    switch (type_)
+    {
+        case json_type::ARRAY:
+        case json_type::OBJECT:
+            return index_->structurals[structural_].match + 1;
+        case json_type::STRING:
+            return structural_ + 1;
+        default:
+            return structural_;
+    }
+}
+
+void
+json_view::for_each_element(
+    std::function<void(json_view const& element)> const& fn) const
+{
+    if (type_ != json_type::ARRAY)
+        return;
+    auto end = index_->structurals[structural_].match;
+    auto delimiter = structural_;
+    while (true)
+    {
+        auto element = value_after(delimiter);
+        if (!element.exists())
+            break;
+        fn(element);
+        delimiter = element.next_structural();
+        if (delimiter >= end)
+            break;
+    }
+}
+
+void
+json_view::for_each_member(
+    std::function<void(std::string_view raw_key, json_view const& value)>
+        const& fn) const
+{
+    if (type_ != json_type::OBJECT)
+        return;
+    auto end = index_->structurals[structural_].match;
+    auto delimiter = structural_;
+    while (true)
+    {
+        auto key = value_after(delimiter);
+        if (key.type_ != json_type::STRING)
+            break;
+        auto raw_key = key.raw();
+        // The colon follows the key directly in the index.
+        auto value = value_after(key.structural_ + 1);
+        fn(raw_key.substr(1, raw_key.size() - 2), value);
+        delimiter = value.exists() ? value.next_structural() : end;
+        if (delimiter >= end)
+            break;
+    }
+}
+
+json_view
+json_view::operator[](std::string_view key) const
+{
+    if (type_ != json_type::OBJECT)
+        return json_view();
+    auto end = index_->structurals[structural_].match;
+    auto delimiter = structural_;
+    while (true)
+    {
+        auto member_key = value_after(delimiter);
+        if (member_key.type_ != json_type::STRING)
+            break;
+        auto value = value_after(member_key.structural_ + 1);
+        auto raw_key = member_key.raw();
+        raw_key = raw_key.substr(1, raw_key.size() - 2);
+        if (raw_key.find('\\') == std::string_view::npos
+                ? raw_key == key
+                : unescape_json_string(raw_key) == key)
+        {
+            return value;
+        }
+        delimiter = value.exists() ? value.next_structural() : end;
+        if (delimiter >= end)
+            break;
+    }
+    return json_view();
+}
+
+json_view
+json_view::operator[](std::size_t index) const
+{
+    if (type_ != json_type::ARRAY)
+        return json_view();
+    auto end = index_->structurals[structural_].match;
+    auto delimiter = structural_;
+    for (std::size_t i = 0;; ++i)
+    {
+        auto element = value_after(delimiter);
+        if (!element.exists())
+            break;
+        if (i == index)
+            return element;
+        delimiter = element.next_structural();
+        if (delimiter >= end)
+            break;
+    }
+    return json_view();
+}
+
+std::size_t
+json_view::size() const
+{
+    std::size_t count = 0;
+    if (type_ == json_type::ARRAY)
+        for_each_element([&](json_view const&) { ++count; });
+    else if (type_ == json_type::OBJECT)
+        for_each_member([&](std::string_view, json_view const&) { ++count; });
+    return count;
+}
+
+std::string_view
+json_view::raw() const
+{
+    if (type_ == json_type::MISSING)
+        return std::string_view();
+
+    auto const& document = index_->document;
+    auto const& structurals = index_->structurals;
+    std::uint32_t end;
+    switch (type_)
+    {
+        case json_type::ARRAY:
+        case json_type::OBJECT:
+            end = structurals[structurals[structural_].match].position + 1;
+            break;
+        case json_type::STRING:
+            end = find_string_end(document, position_) + 1;
+            break;
+        default:
+            end = structural_ < structurals.size()
+                      ? structurals[structural_].position
+                      : std::uint32_t(document.size);
+            while (end > position_
+                   && is_json_whitespace(document.data[end - 1]))
+            {
+                --end;
+            }
+            break;
+    }
+    return std::string_view(document.data + position_, end - position_);
+}
+
+bool
+json_view::as_boolean() const
+{
+    auto text = raw();
+    if (type_ == json_type::BOOLEAN)
+    {
+        if (text == "true")
+            return true;
+        if (text == "false")
+            return false;
+    }
+    throw exception("JSON value isn't a boolean");
+}
+
+double
+json_view::as_number() const
+{
+    auto text = raw();
+    // strtod needs a terminated string, and no valid JSON number is anywhere
+    // near this long.
+    char buffer[64];
+    if (type_ != json_type::NUMBER || text.size() >= sizeof(buffer))
+        throw exception("JSON value isn't a number");
+    std::memcpy(buffer, text.data(), text.size());
+    buffer[text.size()] = '\0';
+    char* end;
+    double value = std::strtod(buffer, &end);
+    if (end != buffer + text.size())
+        throw exception("JSON value isn't a number");
+    return value;
+}
+
+std::string
+json_view::as_string() const
+{
+    if (type_ != json_type::STRING)
+        throw exception("JSON value isn't a string");
+    auto text = raw();
+    return unescape_json_string(text.substr(1, text.size() - 2));
+}
+
+json_path
+parse_json_path(std::string_view path)
+{
+    json_path steps;
+    std::size_t i = 0;
+    while (i != path.size())
+    {
+        char c = path[i];
+        if (c == '.')
+        {
+            ++i;
+            continue;
+        }
+        if (c == '[')
+        {
+            auto close = path.find(']', i);
+            if (close == std::string_view::npos)
+                throw exception("invalid JSON path: unclosed '['");
+            auto inside = path.substr(i + 1, close - i - 1);
+            json_path_step step;
+            if (inside == "*")
+            {
+                step.kind = json_path_step::WILDCARD;
+            }
+            else
+            {
+                if (inside.empty())
+                    throw exception("invalid JSON path: empty index");
+                step.kind = json_path_step::INDEX;
+                for (char digit : inside)
+                {
+                    if (digit < '0' || digit > '9')
+                        throw exception("invalid JSON path: bad index");
+                    step.index = step.index * 10 + std::size_t(digit - '0');
+                }
+            }
+            steps.push_back(std::move(step));
+            i = close + 1;
+            continue;
+        }
+        auto end = path.find_first_of(".[", i);
+        if (end == std::string_view::npos)
+            end = path.size();
+        json_path_step step;
+        step.kind = json_path_step::KEY;
+        step.key = std::string(path.substr(i, end - i));
+        steps.push_back(std::move(step));
+        i = end;
+    }
+    return steps;
+}
+
+namespace {
+
+void
+select_json_from(
+    json_view const& value,
+    json_path const& path,
+    std::size_t step_index,
+    std::function<void(json_view const& value)> const& fn)
+{
+    if (!value.exists())
+        return;
+    if (step_index == path.size())
+    {
+        fn(value);
+        return;
+    }
+    auto const& step = path[step_index];
+    switch (step.kind)
+    {
+        case json_path_step::KEY:
+            select_json_from(value[step.key], path, step_index + 1, fn);
+            break;
+        case json_path_step::INDEX:
+            select_json_from(value[step.index], path, step_index + 1, fn);
+            break;
+        case json_path_step::WILDCARD:
+            value.for_each_element([&](json_view const& element) {
+                select_json_from(element, path, step_index + 1, fn);
+            });
+            value.for_each_member(
+                [&](std::string_view, json_view const& member) {
+                    select_json_from(member, path, step_index + 1, fn);
+                });
+            break;
+    }
+}
+
+} // namespace
+
+void
+select_json(
+    json_view const& root,
+    json_path const& path,
+    std::function<void(json_view const& value)> const& fn)
+{
+    select_json_from(root, path, 0, fn);
+}
+
+}} // namespace alia::html
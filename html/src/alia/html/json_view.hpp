@@ -0,0 +1,255 @@
+#ifndef ALIA_HTML_JSON_VIEW_HPP
+#define ALIA_HTML_JSON_VIEW_HPP
+
+#include <alia/html/fetch.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace alia { namespace html {
+
+// LAZY JSON VIEWS
+//
+// A json_view provides read-only access to a JSON document in a blob without
+// parsing it into a tree. Instead, the document is indexed in a single pass
+// that records the positions of its structural characters (brackets, braces,
+// colons, commas and the starts of strings) and pairs up matching brackets.
+// (When the wasm SIMD build is enabled, the pass skips over uninteresting
+// stretches of the document sixteen bytes at a time.)
+//
+// Navigating the view then just hops around the index. Containers are
+// skipped in constant time, and strings and numbers are only decoded when
+// they're actually read. Nothing is allocated per value.
+//
+// The index is only a structural one, so documents are only validated as
+// far as their brackets and strings go. Malformed scalars are detected when
+// they're read.
+//
+
+enum class json_type
+{
+    // the type of views that don't refer to anything (e.g., missing fields)
+    MISSING,
+    NULL_,
+    BOOLEAN,
+    NUMBER,
+    STRING,
+    ARRAY,
+    OBJECT
+};
+
+namespace detail {
+
+struct json_structural
+{
+    // the position of the character in the document
+    std::uint32_t position;
+    // for opening (closing) brackets, the index of the matching closing
+    // (opening) bracket
+    std::uint32_t match;
+};
+
+struct json_index
+{
+    blob document;
+    std::vector<json_structural> structurals;
+};
+
+} // namespace detail
+
+struct json_view
+{
+    json_view()
+    {
+    }
+
+    json_type
+    type() const;
+
+    bool
+    exists() const
+    {
+        return type_ != json_type::MISSING;
+    }
+
+    // Look up a member of an object. If this isn't an object or the member
+    // doesn't exist, the result is a MISSING view.
+    json_view
+    operator[](std::string_view key) const;
+
+    // Look up an element of an array. If this isn't an array or the index is
+    // out of range, the result is a MISSING view.
+    json_view
+    operator[](std::size_t index) const;
+
+    // the number of elements (or members) of an array (or object)
+    std::size_t
+    size() const;
+
+    void
+    for_each_element(std::function<void(json_view const& element)> const& fn)
+        const;
+
+    // The keys are passed raw (i.e., without decoding escape sequences).
+    void
+    for_each_member(
+        std::function<void(std::string_view raw_key, json_view const& value)>
+            const& fn) const;
+
+    // Read the value as a particular type. These throw if the value is of a
+    // different type.
+    bool
+    as_boolean() const;
+    double
+    as_number() const;
+    // This decodes any escape sequences.
+    std::string
+    as_string() const;
+
+    // the raw text of the value (including quotes, for strings)
+    std::string_view
+    raw() const;
+
+ private:
+    friend json_view
+    index_json(blob const& document);
+
+    std::shared_ptr<detail::json_index const> index_;
+    json_type type_ = json_type::MISSING;
+    // where the value starts in the document
+    std::uint32_t position_ = 0;
+    // For containers and strings, this is the index of the value's first
+    // structural. For other scalars, it's the index of the structural that
+    // follows the value.
+    std::uint32_t structural_ = 0;
+
+    // Get the value that starts at (or after whitespace following) the given
+    // position, where 'next' is the index of the first structural after the
+    // position.
+    json_view
+    value_at(std::uint32_t position, std::uint32_t next) const;
+
+    // Get the value that follows the given structural (an opening bracket, a
+    // comma or a colon).
+    json_view
+    value_after(std::uint32_t structural) const;
+
+    std::uint32_t
+    next_structural() const;
+};
+
+// Index a JSON document.
+// This throws an alia::exception if the document is structurally invalid.
+json_view
+index_json(blob const& document);
+
+// Decode the contents of a JSON string (without its quotes), e.g., a raw key
+// from for_each_member().
+std::string
+unescape_json_string(std::string_view text);
+
+// PATHS
+//
+// Paths select values within a document, in a JavaScript-like syntax:
+// 'items[*].name' selects the name of every item, 'items[0].tags[*]'
+// selects every tag of the first item, etc. (On objects, '[*]' selects the
+// values of all members.)
+//
+
+struct json_path_step
+{
+    enum kind_type
+    {
+        KEY,
+        INDEX,
+        WILDCARD
+    };
+    kind_type kind;
+    std::string key;
+    std::size_t index = 0;
+};
+
+typedef std::vector<json_path_step> json_path;
+
+// Parse a path. This throws an alia::exception if it's invalid.
+json_path
+parse_json_path(std::string_view path);
+
+// Invoke 'fn' on every value that the path selects. (Steps that don't match
+// anything simply select nothing.)
+void
+select_json(
+    json_view const& root,
+    json_path const& path,
+    std::function<void(json_view const& value)> const& fn);
+
+// CONVERSIONS
+
+inline void
+from_json_view(json_view const& view, json_view* value)
+{
+    *value = view;
+}
+inline void
+from_json_view(json_view const& view, bool* value)
+{
+    *value = view.as_boolean();
+}
+inline void
+from_json_view(json_view const& view, double* value)
+{
+    *value = view.as_number();
+}
+inline void
+from_json_view(json_view const& view, int* value)
+{
+    *value = int(view.as_number());
+}
+inline void
+from_json_view(json_view const& view, std::string* value)
+{
+    *value = view.as_string();
+}
+
+// SIGNALS
+
+// Get a signal carrying a view of the (JSON) body of a response.
+template<class Response>
+auto
+view_json(alia::context ctx, Response response)
+{
+    return apply(
+        ctx,
+        [](http_response const& response) {
+            return index_json(response.body);
+        },
+        std::move(response));
+}
+
+// Project a path out of a JSON view, converting each selected value to a T.
+template<class T, class View>
+auto
+project_json(alia::context ctx, View view, char const* path)
+{
+    return apply(
+        ctx,
+        [](json_view const& view, std::string const& path) {
+            std::vector<T> values;
+            select_json(view, parse_json_path(path), [&](json_view const& v) {
+                T value;
+                from_json_view(v, &value);
+                values.push_back(std::move(value));
+            });
+            return values;
+        },
+        std::move(view),
+        value(std::string(path)));
+}
+
+}} // namespace alia::html
+
+#endif
@@ -0,0 +1,34 @@
+#include <alia/html/mutation.hpp>
+
+#include <emscripten/emscripten.h>
+
+namespace alia { namespace html {
+
+namespace detail {
+
+static void
+send_scheduled_mutations(void* arg)
+{
+    std::unique_ptr<std::shared_ptr<mutation_queue_base>> holder(
+        reinterpret_cast<std::shared_ptr<mutation_queue_base>*>(arg));
+    auto& queue = **holder;
+    queue.send_scheduled = false;
+    queue.send();
+}
+
+void
+schedule_mutation_send(mutation_queue_base& queue)
+{
+    if (!queue.send_scheduled)
+    {
+        queue.send_scheduled = true;
+        emscripten_async_call(
+            send_scheduled_mutations,
+            new std::shared_ptr<mutation_queue_base>(queue.shared_from_this()),
+            0);
+    }
+}
+
+} // namespace detail
+
+}} // namespace alia::html
@@ -0,0 +1,297 @@
+#ifndef ALIA_HTML_MUTATION_HPP
+#define ALIA_HTML_MUTATION_HPP
+
+#include <alia/html/context.hpp>
+#include <alia/html/fetch.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace alia { namespace html {
+
+// OPTIMISTIC MUTATIONS
+//
+// optimistic_mutation() creates an action that changes server-side data
+// without making the UI wait for the server. Performing it with a mutation
+// (e.g., 'add this item' or 'delete item 3') immediately applies the mutation
+// to the local state (a duplex signal) and then sends it to the server.
+//
+// - Mutations that are performed while a request for the same mutation
+//   action is in flight (or in the same event) are batched into a single
+//   request. (Requests are sent one at a time, so the server sees the
+//   mutations in the order they were made.)
+//
+// - If a request fails (i.e., there's no 2xx response), its mutations are
+//   rolled back: the state reverts to its last confirmed value, with any
+//   mutations that haven't been sent yet reapplied on top of it.
+//
+// - Optionally, the state can be reconciled with the server's response to
+//   each successful request (e.g., to pick up server-assigned IDs).
+//
+// Rollbacks and reconciliations are written to the state signal on the next
+// refresh. (Any changes made to the state by other means while mutations are
+// pending are overwritten by them.)
+//
+// Requests that are in flight when the component goes away still complete.
+//
+
+struct mutation_status
+{
+    // the number of mutations that have been applied locally but haven't been
+    // confirmed by the server yet
+    std::size_t pending = 0;
+    // the number of mutations that have been rolled back
+    std::size_t failed = 0;
+    // the response to the last failed request (with a status code of 0 if it
+    // failed at the network level)
+    http_response last_failure = http_response();
+};
+
+namespace detail {
+
+struct mutation_queue_base
+    : std::enable_shared_from_this<mutation_queue_base>
+{
+    virtual ~mutation_queue_base()
+    {
+    }
+
+    // Send the queued mutations (unless there's already a request in
+    // flight, in which case they'll be sent when it finishes).
+    virtual void
+    send() = 0;
+
+    alia::system* system = nullptr;
+    bool send_scheduled = false;
+    fetch_handle fetch;
+
+    mutation_status status;
+    unsigned status_version = 0;
+};
+
+// Schedule the queue to send its mutations once the current event is done.
+void
+schedule_mutation_send(mutation_queue_base& queue);
+
+template<class Value, class Mutation>
+struct mutation_queue : mutation_queue_base
+{
+    std::function<void(Value& value, Mutation const& mutation)> apply;
+    std::function<http_request(std::vector<Mutation> const& mutations)>
+        make_request;
+    std::function<void(Value& value, http_response const& response)>
+        reconcile;
+
+    // the state as of the last confirmation from the server - This is only
+    // maintained while there are pending mutations.
+    std::optional<Value> confirmed;
+    // the mutations in the request that's in flight
+    std::vector<Mutation> in_flight;
+    // the mutations that are waiting to be sent
+    std::vector<Mutation> queued;
+
+    // a value that should be written back to the state signal (after a
+    // rollback or reconciliation)
+    std::optional<Value> correction;
+
+    // Apply a mutation to 'value' (the current local state) and queue it.
+    void
+    perform(Value& value, Mutation mutation)
+    {
+        if (!confirmed)
+            confirmed = value;
+        apply(value, mutation);
+        queued.push_back(std::move(mutation));
+        update_status();
+        schedule_mutation_send(*this);
+    }
+
+    void
+    send() override
+    {
+        if (fetch || queued.empty())
+            return;
+        in_flight = std::move(queued);
+        queued.clear();
+        // The queue keeps itself alive until the request finishes.
+        auto self = std::static_pointer_cast<mutation_queue>(
+            this->shared_from_this());
+        fetch = launch_fetch(
+            make_request(in_flight),
+            [self](http_response const& response) {
+                self->handle_response(response);
+            });
+    }
+
+    void
+    handle_response(http_response const& response)
+    {
+        auto batch = std::move(in_flight);
+        in_flight.clear();
+        fetch.reset();
+
+        bool succeeded
+            = response.status_code >= 200 && response.status_code < 300;
+        Value base = std::move(*confirmed);
+        if (succeeded)
+        {
+            for (auto const& mutation : batch)
+                apply(base, mutation);
+            if (reconcile)
+                reconcile(base, response);
+        }
+        else
+        {
+            status.failed += batch.size();
+            status.last_failure = response;
+        }
+
+        // Rebase the mutations that haven't been sent yet onto the new
+        // confirmed value.
+        if (!succeeded || reconcile)
+        {
+            Value corrected = base;
+            for (auto const& mutation : queued)
+                apply(corrected, mutation);
+            correction = std::move(corrected);
+        }
+        if (queued.empty())
+            confirmed.reset();
+        else
+            confirmed = std::move(base);
+
+        update_status();
+        send();
+        refresh_system_when_visible(*system);
+    }
+
+    void
+    update_status()
+    {
+        status.pending = in_flight.size() + queued.size();
+        ++status_version;
+    }
+};
+
+template<class Value, class Mutation>
+struct mutation_data
+{
+    std::shared_ptr<mutation_queue<Value, Mutation>> queue
+        = std::make_shared<mutation_queue<Value, Mutation>>();
+};
+
+} // namespace detail
+
+struct mutation_status_signal
+    : signal<mutation_status_signal, mutation_status, read_only_signal>
+{
+    explicit mutation_status_signal(detail::mutation_queue_base* queue)
+        : queue_(queue)
+    {
+    }
+
+    bool
+    has_value() const override
+    {
+        return true;
+    }
+
+    mutation_status const&
+    read() const override
+    {
+        return queue_->status;
+    }
+
+    simple_id<unsigned> const&
+    value_id() const override
+    {
+        id_ = make_id(queue_->status_version);
+        return id_;
+    }
+
+ private:
+    detail::mutation_queue_base* queue_;
+    mutable simple_id<unsigned> id_;
+};
+
+template<class Action>
+struct mutation_controls
+{
+    // Perform this (with a mutation) to apply the mutation.
+    Action perform;
+    // the status of the mutations performed through this
+    mutation_status_signal status;
+};
+
+// Create an optimistic mutation action for 'state'.
+//
+// 'apply(Value& value, Mutation const& mutation)' applies a mutation to a
+// value. (It's used both for the local update and for rebasing pending
+// mutations after a rollback, so it should be deterministic.)
+//
+// 'make_request(std::vector<Mutation> const& mutations)' makes the request
+// that sends a batch of mutations to the server.
+//
+// If given, 'reconcile(Value& value, http_response const& response)' is
+// applied to the confirmed value (with the batch already applied) after each
+// successful request.
+//
+template<
+    class Mutation,
+    class State,
+    class Apply,
+    class MakeRequest,
+    class Reconcile = std::nullptr_t>
+auto
+optimistic_mutation(
+    html::context ctx,
+    State state,
+    Apply apply,
+    MakeRequest make_request,
+    Reconcile reconcile = nullptr)
+{
+    typedef typename State::value_type value_type;
+    auto& data = get_cached_data<detail::mutation_data<value_type, Mutation>>(
+        ctx);
+    auto* queue = data.queue.get();
+
+    refresh_handler(ctx, [&](auto ctx) {
+        queue->system = &get<alia::system_tag>(ctx);
+        queue->apply = std::move(apply);
+        queue->make_request = std::move(make_request);
+        if constexpr (!std::is_same_v<Reconcile, std::nullptr_t>)
+            queue->reconcile = std::move(reconcile);
+        if (queue->correction && signal_ready_to_write(state))
+        {
+            write_signal(state, std::move(*queue->correction));
+            queue->correction.reset();
+        }
+    });
+
+    auto perform = callback(
+        [state, queue]() {
+            return queue->apply && signal_has_value(state)
+                   && signal_ready_to_write(state);
+        },
+        [state, queue](Mutation mutation) {
+            // If there's a correction that hasn't been written yet, it
+            // supersedes the state.
+            value_type value = queue->correction
+                                   ? std::move(*queue->correction)
+                                   : read_signal(state);
+            queue->correction.reset();
+            queue->perform(value, std::move(mutation));
+            write_signal(state, std::move(value));
+        });
+
+    return mutation_controls<decltype(perform)>{
+        std::move(perform), mutation_status_signal(queue)};
+}
+
+}} // namespace alia::html
+
+#endif
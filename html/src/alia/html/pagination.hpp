@@ -0,0 +1,367 @@
+#ifndef ALIA_HTML_PAGINATION_HPP
+#define ALIA_HTML_PAGINATION_HPP
+
+#include <alia/html/context.hpp>
+#include <alia/html/fetch.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace alia { namespace html {
+
+// PAGINATED COLLECTIONS
+//
+// paged_collection() presents a paginated endpoint (e.g., an infinite-scroll
+// feed) as a single collection, of which only a window is loaded at any
+// time. The app says which range of items it wants (typically the ones that
+// are scrolled into view), and the collection:
+//
+// - loads the pages that cover that window (at VISIBLE priority),
+//
+// - prefetches the pages just past the end of it (at PREFETCH priority), so
+//   that they're usually ready before they're scrolled to, and
+//
+// - evicts pages that are far outside of it, so memory use stays bounded no
+//   matter how far the user scrolls.
+//
+// Each item carries its index within the whole collection, which also serves
+// as its ID for for_each(), so the DOM nodes of items that stay in the window
+// are kept as the window moves.
+//
+
+// a range of item indices: [begin, end)
+struct item_window
+{
+    std::size_t begin = 0;
+    std::size_t end = 0;
+};
+
+inline bool
+operator==(item_window const& a, item_window const& b)
+{
+    return a.begin == b.begin && a.end == b.end;
+}
+inline bool
+operator!=(item_window const& a, item_window const& b)
+{
+    return !(a == b);
+}
+
+struct pagination_config
+{
+    std::size_t page_size = 50;
+    // the number of pages past the end of the window to prefetch
+    std::size_t prefetch_pages = 1;
+    // Pages that are more than this many pages outside the window (and the
+    // prefetched pages) are evicted.
+    std::size_t retained_pages = 2;
+};
+
+// what the app's parser extracts from the response for a page
+template<class Item>
+struct page_contents
+{
+    std::vector<Item> items;
+    // the total number of items in the collection, if the endpoint reports
+    // it - Otherwise, a page with fewer than page_size items is taken to be
+    // the last one.
+    std::optional<std::size_t> total;
+};
+
+template<class Item>
+struct paged_item
+{
+    // the index of the item within the whole collection
+    std::size_t index;
+    Item value;
+};
+
+// This lets for_each() identify items by their indices.
+template<class Item>
+auto
+get_alia_item_id(paged_item<Item> const& item)
+{
+    return make_id(item.index);
+}
+
+template<class Item>
+struct paged_view
+{
+    // the loaded items within the window, in order - Items whose pages
+    // haven't arrived yet are omitted.
+    std::vector<paged_item<Item>> items;
+    // the total number of items, if it's known yet
+    std::optional<std::size_t> total;
+    // Are any of the pages within the window still loading?
+    bool loading = false;
+    // Did any of the pages within the window fail to load? (Failed pages are
+    // retried when the window changes.)
+    bool failed = false;
+};
+
+namespace detail {
+
+template<class Item>
+struct paged_collection_data : noncopyable
+{
+    struct page
+    {
+        bool loaded = false;
+        bool failed = false;
+        std::vector<Item> items;
+        fetch_handle fetch;
+    };
+
+    alia::system* system = nullptr;
+    pagination_config config;
+    std::function<http_request(std::size_t page, std::size_t page_size)>
+        make_request;
+    std::function<page_contents<Item>(http_response const& response)>
+        parse_page;
+
+    captured_id window_id;
+    item_window window;
+    std::map<std::size_t, page> pages;
+    std::optional<std::size_t> total;
+
+    paged_view<Item> view;
+    unsigned version = 0;
+
+    // the number of pages, if it's known
+    std::optional<std::size_t>
+    page_count() const
+    {
+        if (!total)
+            return std::nullopt;
+        return (*total + config.page_size - 1) / config.page_size;
+    }
+
+    void
+    update(bool retry_failed)
+    {
+        std::size_t page_size = config.page_size;
+        std::size_t first = window.begin / page_size;
+        std::size_t last = window.end > window.begin
+                               ? (window.end - 1) / page_size
+                               : first;
+        std::size_t prefetch_end = last + 1 + config.prefetch_pages;
+        if (auto count = page_count())
+        {
+            last = std::min(last, *count);
+            prefetch_end = std::min(prefetch_end, *count);
+        }
+
+        // Evict the pages that are too far away.
+        std::size_t keep_begin
+            = first > config.retained_pages ? first - config.retained_pages
+                                            : 0;
+        std::size_t keep_end = prefetch_end + config.retained_pages;
+        for (auto i = pages.begin(); i != pages.end();)
+        {
+            if (i->first < keep_begin || i->first >= keep_end)
+                i = pages.erase(i);
+            else
+                ++i;
+        }
+
+        for (std::size_t index = first; index < prefetch_end; ++index)
+        {
+            auto priority = index <= last && window.end > window.begin
+                                ? fetch_priority::VISIBLE
+                                : fetch_priority::PREFETCH;
+            auto existing = pages.find(index);
+            if (existing != pages.end())
+            {
+                auto& page = existing->second;
+                if (page.failed && retry_failed)
+                {
+                    pages.erase(existing);
+                }
+                else
+                {
+                    // A prefetched page that has scrolled into the window
+                    // is needed sooner now.
+                    if (!page.loaded && page.fetch
+                        && get_fetch_priority(page.fetch) != priority)
+                    {
+                        set_fetch_priority(page.fetch, priority);
+                    }
+                    continue;
+                }
+            }
+            auto& page = pages[index];
+            page.fetch = launch_fetch(
+                make_request(index, page_size),
+                [this, index](http_response const& response) {
+                    handle_page(index, response);
+                },
+                priority);
+        }
+
+        rebuild_view();
+    }
+
+    void
+    handle_page(std::size_t index, http_response const& response)
+    {
+        auto& page = pages[index];
+        page.loaded = false;
+        page.failed = false;
+        if (response.status_code >= 200 && response.status_code < 300)
+        {
+            try
+            {
+                auto contents = parse_page(response);
+                page.items = std::move(contents.items);
+                page.loaded = true;
+                if (contents.total)
+                    total = contents.total;
+                else if (page.items.size() < config.page_size)
+                    total = index * config.page_size + page.items.size();
+            }
+            catch (...)
+            {
+                page.failed = true;
+            }
+        }
+        else
+        {
+            page.failed = true;
+        }
+        // Learning the total may have changed which pages are needed.
+        update(false);
+        refresh_system_when_visible(*system);
+    }
+
+    void
+    rebuild_view()
+    {
+        view.items.clear();
+        view.total = total;
+        view.loading = false;
+        view.failed = false;
+        std::size_t end = window.end;
+        if (total)
+            end = std::min(end, *total);
+        std::size_t page_size = config.page_size;
+        for (std::size_t i = window.begin; i < end;)
+        {
+            std::size_t index = i / page_size;
+            std::size_t page_end = std::min((index + 1) * page_size, end);
+            auto page = pages.find(index);
+            if (page == pages.end() || !page->second.loaded)
+            {
+                if (page != pages.end() && page->second.failed)
+                    view.failed = true;
+                else
+                    view.loading = true;
+            }
+            else
+            {
+                auto const& items = page->second.items;
+                for (std::size_t j = i; j < page_end; ++j)
+                {
+                    std::size_t offset = j - index * page_size;
+                    if (offset < items.size())
+                        view.items.push_back({j, items[offset]});
+                }
+            }
+            i = page_end;
+        }
+        ++version;
+    }
+};
+
+} // namespace detail
+
+template<class Item>
+struct paged_collection_signal : signal<
+                                     paged_collection_signal<Item>,
+                                     paged_view<Item>,
+                                     read_only_signal>
+{
+    explicit paged_collection_signal(
+        detail::paged_collection_data<Item>* data)
+        : data_(data)
+    {
+    }
+
+    bool
+    has_value() const override
+    {
+        return true;
+    }
+
+    paged_view<Item> const&
+    read() const override
+    {
+        return data_->view;
+    }
+
+    simple_id<unsigned> const&
+    value_id() const override
+    {
+        id_ = make_id(data_->version);
+        return id_;
+    }
+
+ private:
+    detail::paged_collection_data<Item>* data_;
+    mutable simple_id<unsigned> id_;
+};
+
+// Get a paginated collection of Items, loading the pages that cover 'window'.
+//
+// 'make_request(std::size_t page, std::size_t page_size)' makes the request
+// for a page (numbered from 0).
+//
+// 'parse_page(http_response const& response)' extracts a page_contents<Item>
+// from a response. If it throws, the page is considered failed.
+//
+// While the window has no value, nothing new is loaded.
+//
+template<class Item, class MakeRequest, class ParsePage>
+paged_collection_signal<Item>
+paged_collection(
+    html::context ctx,
+    readable<item_window> window,
+    MakeRequest make_request,
+    ParsePage parse_page,
+    pagination_config const& config = pagination_config())
+{
+    auto& data = get_cached_data<detail::paged_collection_data<Item>>(ctx);
+
+    refresh_handler(ctx, [&](auto ctx) {
+        data.system = &get<alia::system_tag>(ctx);
+        data.make_request = std::move(make_request);
+        data.parse_page = std::move(parse_page);
+        if (config.page_size != data.config.page_size)
+        {
+            // The existing pages are meaningless with a new page size, so
+            // drop them and force the window to be reloaded.
+            data.config = config;
+            data.pages.clear();
+            data.total.reset();
+            data.rebuild_view();
+            data.window_id.clear();
+        }
+        data.config = config;
+        refresh_signal_view(
+            data.window_id,
+            window,
+            [&](item_window const& new_window) {
+                data.window = new_window;
+                data.update(true);
+            },
+            [&]() {});
+    });
+
+    return paged_collection_signal<Item>(&data);
+}
+
+}} // namespace alia::html
+
+#endif
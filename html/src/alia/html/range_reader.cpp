@@ -0,0 +1,536 @@
+#include <alia/html/range_reader.hpp>
+
+#include <emscripten/emscripten.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace alia { namespace html {
+
+// HTTP TRANSPORT
+
+namespace {
+
+struct http_range_transport
+    : range_transport,
+      std::enable_shared_from_this<http_range_transport>
+{
+    std::string url;
+    http_headers headers;
+
+    // the handles for the requests that are in flight
+    std::unordered_map<unsigned, fetch_handle> requests;
+    unsigned next_request_id = 0;
+
+    void
+    fetch_range(
+        std::uint64_t offset,
+        std::uint64_t size,
+        std::function<void(range_response const& response)> callback)
+        override;
+};
+
+// Parse the total size out of a Content-Range header (e.g.,
+// 'bytes 0-1023/4096').
+bool
+parse_content_range_total(std::string const& header, std::uint64_t* total)
+{
+    auto slash = header.find('/');
+    if (slash == std::string::npos || header.compare(slash + 1, 1, "*") == 0)
+        return false;
+    *total = std::strtoull(header.c_str() + slash + 1, nullptr, 10);
+    return true;
+}
+
+range_response
+interpret_range_response(
+    http_response const& response, std::uint64_t offset, std::uint64_t size)
+{
+    range_response result;
+    if (response.status_code == 206)
+    {
+        result.success = true;
+        result.data = response.body;
+        auto content_range = response.headers.find("content-range");
+        if (content_range != response.headers.end())
+        {
+            result.file_size_known = parse_content_range_total(
+                content_range->second, &result.file_size);
+        }
+    }
+    else if (response.status_code == 200)
+    {
+        // The server ignored the Range header and sent the whole file, so
+        // slice out the part we asked for.
+        result.success = true;
+        result.file_size_known = true;
+        result.file_size = response.body.size;
+        auto start = (std::min)(offset, response.body.size);
+        auto end = (std::min)(offset + size, response.body.size);
+        result.data = blob{
+            response.body.data + start,
+            end - start,
+            response.body.ownership};
+    }
+    else if (response.status_code == 416)
+    {
+        // The range is entirely past the end of the file.
+        result.success = true;
+        auto content_range = response.headers.find("content-range");
+        if (content_range != response.headers.end())
+        {
+            result.file_size_known = parse_content_range_total(
+                content_range->second, &result.file_size);
+        }
+    }
+    return result;
+}
+
+void
+http_range_transport::fetch_range(
+    std::uint64_t offset,
+    std::uint64_t size,
+    std::function<void(range_response const& response)> callback)
+{
+    http_request request{http_method::GET, this->url, this->headers, blob()};
+    request.headers["Range"] = "bytes=" + std::to_string(offset) + "-"
+                               + std::to_string(offset + size - 1);
+
+    unsigned id = this->next_request_id++;
+    std::weak_ptr<http_range_transport> weak_self = this->shared_from_this();
+    this->requests[id] = launch_fetch(
+        request, [=](http_response const& response) {
+            auto self = weak_self.lock();
+            if (!self)
+                return;
+            self->requests.erase(id);
+            callback(interpret_range_response(response, offset, size));
+        });
+}
+
+} // namespace
+
+std::shared_ptr<range_transport>
+make_http_range_transport(std::string const& url, http_headers const& headers)
+{
+    auto transport = std::make_shared<http_range_transport>();
+    transport->url = url;
+    transport->headers = headers;
+    return transport;
+}
+
+// READER
+
+namespace detail {
+
+struct pending_read
+{
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::uint64_t first_page;
+    // the pages that the read spans, as they arrive
+    std::vector<blob> pages;
+    unsigned missing_pages = 0;
+    bool failed = false;
+    range_read_callback callback;
+};
+
+struct cached_page
+{
+    blob data;
+    std::list<std::uint64_t>::iterator lru_position;
+};
+
+struct range_reader_state
+    : std::enable_shared_from_this<range_reader_state>
+{
+    std::shared_ptr<range_transport> transport;
+    range_reader_config config;
+
+    bool file_size_known = false;
+    std::uint64_t file_size = 0;
+
+    std::unordered_map<std::uint64_t, cached_page> cache;
+    // the indices of the cached pages, most recently used first
+    std::list<std::uint64_t> lru;
+
+    // the pages that have been requested from the transport
+    std::unordered_set<std::uint64_t> in_flight;
+    // the pages that will be requested at the next flush
+    std::set<std::uint64_t> wanted;
+    // the reads that are waiting on each page
+    std::unordered_map<
+        std::uint64_t,
+        std::vector<std::shared_ptr<pending_read>>>
+        waiters;
+    // the reads that can be completed at the next flush
+    std::vector<std::shared_ptr<pending_read>> ready;
+
+    bool flush_scheduled = false;
+
+    // the last page of the previous read, for detecting sequential access
+    bool has_last_page = false;
+    std::uint64_t last_page = 0;
+};
+
+static void
+complete_read(range_reader_state& state, pending_read& read)
+{
+    if (read.failed)
+    {
+        read.callback(false, blob());
+        return;
+    }
+
+    auto page_size = state.config.page_size;
+    std::uint64_t start = read.offset - read.first_page * page_size;
+
+    // Figure out how much data is actually available, since pages at the end
+    // of the file may be short.
+    std::uint64_t available = 0;
+    for (auto const& page : read.pages)
+    {
+        available += page.size;
+        if (page.size < page_size)
+            break;
+    }
+    std::uint64_t size
+        = start < available ? (std::min)(read.size, available - start) : 0;
+
+    if (read.pages.size() == 1 || size == 0)
+    {
+        // The data is within a single page, so just share the page's memory.
+        auto const& page = read.pages.front();
+        char const* data = size != 0 ? page.data + start : page.data;
+        read.callback(true, blob{data, size, page.ownership});
+        return;
+    }
+
+    // Otherwise, assemble the data from the pages.
+    std::shared_ptr<char> storage(new char[size], array_deleter<char>());
+    std::uint64_t copied = 0;
+    for (auto const& page : read.pages)
+    {
+        if (copied == size)
+            break;
+        std::uint64_t page_start = copied == 0 ? start : 0;
+        if (page_start >= page.size)
+            continue;
+        auto n = (std::min)(page.size - page_start, size - copied);
+        std::memcpy(
+            storage.get() + copied, page.data + page_start, std::size_t(n));
+        copied += n;
+    }
+    read.callback(true, blob{storage.get(), size, storage});
+}
+
+static void
+cache_page(range_reader_state& state, std::uint64_t index, blob const& data)
+{
+    auto existing = state.cache.find(index);
+    if (existing != state.cache.end())
+    {
+        state.lru.erase(existing->second.lru_position);
+        state.cache.erase(existing);
+    }
+    state.lru.push_front(index);
+    state.cache[index] = cached_page{data, state.lru.begin()};
+    while (state.cache.size() > state.config.max_cached_pages)
+    {
+        state.cache.erase(state.lru.back());
+        state.lru.pop_back();
+    }
+}
+
+static void
+resolve_page(
+    range_reader_state& state,
+    std::uint64_t index,
+    bool success,
+    blob const& data)
+{
+    auto waiters = state.waiters.find(index);
+    if (waiters == state.waiters.end())
+        return;
+    auto reads = std::move(waiters->second);
+    state.waiters.erase(waiters);
+    for (auto& read : reads)
+    {
+        if (success)
+            read->pages[std::size_t(index - read->first_page)] = data;
+        else
+            read->failed = true;
+        if (--read->missing_pages == 0)
+            complete_read(state, *read);
+    }
+}
+
+static void
+handle_range_response(
+    range_reader_state& state,
+    std::uint64_t first_page,
+    std::uint64_t page_count,
+    range_response const& response)
+{
+    auto page_size = state.config.page_size;
+
+    if (response.success)
+    {
+        if (response.file_size_known)
+        {
+            state.file_size_known = true;
+            state.file_size = response.file_size;
+        }
+        else if (
+            response.data.size < page_count * page_size
+            && (response.data.size != 0 || first_page == 0))
+        {
+            // A short response means we've hit the end of the file. (An
+            // empty one only tells us that the file ends somewhere before
+            // the range.)
+            state.file_size_known = true;
+            state.file_size = first_page * page_size + response.data.size;
+        }
+    }
+
+    for (std::uint64_t i = 0; i != page_count; ++i)
+    {
+        auto index = first_page + i;
+        state.in_flight.erase(index);
+        if (response.success)
+        {
+            // Each page shares the memory of the response.
+            auto start = (std::min)(i * page_size, response.data.size);
+            auto end = (std::min)(start + page_size, response.data.size);
+            blob page{
+                response.data.data + start,
+                end - start,
+                response.data.ownership};
+            cache_page(state, index, page);
+            resolve_page(state, index, true, page);
+        }
+        else
+        {
+            resolve_page(state, index, false, blob());
+        }
+    }
+}
+
+static void
+flush(range_reader_state& state)
+{
+    auto ready = std::move(state.ready);
+    state.ready.clear();
+    for (auto& read : ready)
+        complete_read(state, *read);
+
+    // Request the wanted pages, combining runs of adjacent pages.
+    auto page_size = state.config.page_size;
+    std::weak_ptr<range_reader_state> weak_state = state.shared_from_this();
+    auto i = state.wanted.begin();
+    while (i != state.wanted.end())
+    {
+        std::uint64_t first = *i;
+        std::uint64_t count = 1;
+        ++i;
+        while (i != state.wanted.end() && *i == first + count
+               && count < state.config.max_coalesced_pages)
+        {
+            ++count;
+            ++i;
+        }
+        for (std::uint64_t j = 0; j != count; ++j)
+            state.in_flight.insert(first + j);
+        state.transport->fetch_range(
+            first * page_size,
+            count * page_size,
+            [=](range_response const& response) {
+                auto state = weak_state.lock();
+                if (state)
+                    handle_range_response(*state, first, count, response);
+            });
+    }
+    state.wanted.clear();
+}
+
+static void
+flush_callback(void* arg)
+{
+    std::unique_ptr<std::weak_ptr<range_reader_state>> holder(
+        reinterpret_cast<std::weak_ptr<range_reader_state>*>(arg));
+    auto state = holder->lock();
+    if (state)
+    {
+        state->flush_scheduled = false;
+        flush(*state);
+    }
+}
+
+static void
+schedule_flush(range_reader_state& state)
+{
+    if (!state.flush_scheduled)
+    {
+        state.flush_scheduled = true;
+        emscripten_async_call(
+            flush_callback,
+            new std::weak_ptr<range_reader_state>(state.shared_from_this()),
+            0);
+    }
+}
+
+static bool
+page_exists(range_reader_state const& state, std::uint64_t index)
+{
+    return !state.file_size_known
+           || index * state.config.page_size < state.file_size;
+}
+
+static void
+want_page(range_reader_state& state, std::uint64_t index)
+{
+    if (state.cache.find(index) == state.cache.end()
+        && state.in_flight.find(index) == state.in_flight.end())
+    {
+        state.wanted.insert(index);
+    }
+}
+
+} // namespace detail
+
+range_reader::range_reader(
+    std::shared_ptr<range_transport> transport,
+    range_reader_config const& config)
+    : state_(std::make_shared<detail::range_reader_state>())
+{
+    state_->transport = std::move(transport);
+    state_->config = config;
+}
+
+range_reader::~range_reader()
+{
+}
+
+void
+range_reader::read(
+    std::uint64_t offset, std::uint64_t size, range_read_callback callback)
+{
+    auto& state = *state_;
+    auto page_size = state.config.page_size;
+
+    auto read = std::make_shared<detail::pending_read>();
+    read->offset = offset;
+    read->size = size;
+    read->callback = std::move(callback);
+
+    if (state.file_size_known)
+    {
+        read->size = offset < state.file_size
+                         ? (std::min)(size, state.file_size - offset)
+                         : 0;
+    }
+
+    if (read->size == 0)
+    {
+        read->first_page = 0;
+        read->pages.resize(1);
+        state.ready.push_back(read);
+        detail::schedule_flush(state);
+        return;
+    }
+
+    std::uint64_t first = offset / page_size;
+    std::uint64_t last = (offset + read->size - 1) / page_size;
+    read->first_page = first;
+    read->pages.resize(std::size_t(last - first + 1));
+
+    for (std::uint64_t index = first; index <= last; ++index)
+    {
+        auto cached = state.cache.find(index);
+        if (cached != state.cache.end())
+        {
+            state.lru.splice(
+                state.lru.begin(), state.lru, cached->second.lru_position);
+            read->pages[std::size_t(index - first)] = cached->second.data;
+        }
+        else
+        {
+            ++read->missing_pages;
+            state.waiters[index].push_back(read);
+            detail::want_page(state, index);
+        }
+    }
+    if (read->missing_pages == 0)
+        state.ready.push_back(read);
+
+    // If this read continues where the last one left off, read ahead.
+    if (state.has_last_page && first <= state.last_page + 1
+        && last >= state.last_page)
+    {
+        for (unsigned i = 1; i <= state.config.read_ahead_pages; ++i)
+        {
+            if (!detail::page_exists(state, last + i))
+                break;
+            detail::want_page(state, last + i);
+        }
+    }
+    state.has_last_page = true;
+    state.last_page = last;
+
+    detail::schedule_flush(state);
+}
+
+bool
+range_reader::file_size_known() const
+{
+    return state_->file_size_known;
+}
+
+std::uint64_t
+range_reader::file_size() const
+{
+    return state_->file_size;
+}
+
+std::size_t
+range_reader::cached_page_count() const
+{
+    return state_->cache.size();
+}
+
+async_signal<blob>
+read_range(
+    alia::context ctx,
+    range_reader& reader,
+    readable<std::uint64_t> offset,
+    readable<std::uint64_t> size)
+{
+    return async<blob>(
+        ctx,
+        [&](auto ctx,
+            auto reporter,
+            std::uint64_t offset,
+            std::uint64_t size) {
+            reader.read(offset, size, [reporter](bool success, blob data) {
+                if (success)
+                {
+                    reporter.report_success(data);
+                }
+                else
+                {
+                    reporter.report_failure(std::make_exception_ptr(
+                        exception("range read failed")));
+                }
+            });
+        },
+        offset,
+        size);
+}
+
+}} // namespace alia::html
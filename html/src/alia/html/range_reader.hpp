@@ -0,0 +1,130 @@
+#ifndef ALIA_HTML_RANGE_READER_HPP
+#define ALIA_HTML_RANGE_READER_HPP
+
+#include <alia/html/context.hpp>
+#include <alia/html/fetch.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace alia { namespace html {
+
+// RANGE READER
+//
+// A range_reader presents a remote file as random-access memory, split into
+// fixed-size pages that are fetched on demand with HTTP Range requests.
+//
+// - Fetched pages are kept in a bounded cache, with the least recently used
+//   pages being evicted first.
+//
+// - When pages are accessed sequentially, the pages that follow are read
+//   ahead of time.
+//
+// - Pages that are requested during the same event are coalesced, so that
+//   runs of adjacent pages are fetched with a single request.
+//
+// Pages share the memory of the responses that they came in, and reads that
+// fall within a single page share the memory of the page, so neither involves
+// copying.
+//
+// The reader talks to the server through a range_transport, so it can be
+// tested against stand-ins. (scripts/run-range-server.py serves local files
+// with Range support.)
+//
+
+struct range_response
+{
+    bool success = false;
+    blob data;
+    // the total size of the file, if the transport learned it
+    bool file_size_known = false;
+    std::uint64_t file_size = 0;
+};
+
+struct range_transport
+{
+    virtual ~range_transport()
+    {
+    }
+
+    // Fetch the bytes in [offset, offset + size).
+    // The response may be short if the range extends past the end of the
+    // file. The callback must not be invoked from within this call.
+    virtual void
+    fetch_range(
+        std::uint64_t offset,
+        std::uint64_t size,
+        std::function<void(range_response const& response)> callback)
+        = 0;
+};
+
+// Create a transport that fetches ranges of the given URL through
+// launch_fetch(). (The server may ignore the Range header and send the whole
+// file, in which case the requested range is sliced out of it.)
+std::shared_ptr<range_transport>
+make_http_range_transport(
+    std::string const& url, http_headers const& headers = http_headers());
+
+struct range_reader_config
+{
+    std::uint64_t page_size = 64 * 1024;
+    // the maximum number of pages kept in the cache
+    std::size_t max_cached_pages = 256;
+    // the number of pages to read ahead during sequential access
+    unsigned read_ahead_pages = 4;
+    // the maximum number of adjacent pages to fetch in a single request
+    unsigned max_coalesced_pages = 16;
+};
+
+namespace detail {
+struct range_reader_state;
+}
+
+typedef std::function<void(bool success, blob data)> range_read_callback;
+
+struct range_reader : noncopyable
+{
+    explicit range_reader(
+        std::shared_ptr<range_transport> transport,
+        range_reader_config const& config = range_reader_config());
+
+    ~range_reader();
+
+    // Read the bytes in [offset, offset + size). The callback is always
+    // invoked asynchronously (even if the data is already cached). Reads that
+    // extend past the end of the file are truncated.
+    void
+    read(
+        std::uint64_t offset,
+        std::uint64_t size,
+        range_read_callback callback);
+
+    // Is the size of the file known yet? (It's learned from the first
+    // response.)
+    bool
+    file_size_known() const;
+
+    std::uint64_t
+    file_size() const;
+
+    // the number of pages currently in the cache
+    std::size_t
+    cached_page_count() const;
+
+ private:
+    std::shared_ptr<detail::range_reader_state> state_;
+};
+
+// Read a range of a file as a signal.
+async_signal<blob>
+read_range(
+    alia::context ctx,
+    range_reader& reader,
+    readable<std::uint64_t> offset,
+    readable<std::uint64_t> size);
+
+}} // namespace alia::html
+
+#endif
@@ -0,0 +1,317 @@
+#include <alia/html/route_data.hpp>
+
+#include <emscripten/emscripten.h>
+
+#include <map>
+
+namespace alia { namespace html {
+
+namespace {
+
+struct route_data_declaration
+{
+    std::string pattern;
+    detail::route_data_matcher matcher;
+};
+
+std::vector<route_data_declaration> route_data_declarations;
+
+// prefetches that are still waiting for their responses, by method, URL and
+// headers
+std::map<std::string, fetch_handle> active_prefetches;
+
+std::string
+get_prefetch_key(http_request const& request)
+{
+    std::string key = to_string(request.method) + " " + request.url;
+    for (auto const& header : request.headers)
+        key += "\n" + header.first + ": " + header.second;
+    return key;
+}
+
+// LOADS
+
+// A route_load is the load of a single request. It's shared by all the
+// route_loads that include that request.
+struct route_load : noncopyable
+{
+    ~route_load();
+
+    std::string key;
+    bool finished = false;
+    http_response response;
+    fetch_handle fetch;
+    std::vector<std::weak_ptr<detail::route_loads>> waiters;
+};
+
+// all route loads that are still alive, by the same key as prefetches
+std::map<std::string, std::weak_ptr<route_load>> route_loads_by_key;
+
+route_load::~route_load()
+{
+    auto i = route_loads_by_key.find(key);
+    if (i != route_loads_by_key.end() && i->second.expired())
+        route_loads_by_key.erase(i);
+}
+
+std::shared_ptr<route_load>
+find_finished_route_load(std::string const& key)
+{
+    auto i = route_loads_by_key.find(key);
+    if (i == route_loads_by_key.end())
+        return nullptr;
+    auto load = i->second.lock();
+    return load && load->finished ? load : nullptr;
+}
+
+} // namespace
+
+namespace detail {
+
+struct route_loads : noncopyable
+{
+    std::vector<std::shared_ptr<route_load>> loads;
+    unsigned pending = 0;
+    std::function<void()> on_finished;
+};
+
+} // namespace detail
+
+namespace {
+
+void
+finish_route_load(route_load& load, http_response const& response)
+{
+    load.response = response;
+    // The fetch layer may deliver a second response (if a stale one from the
+    // cache is superseded), but by then, the load is already finished.
+    if (load.finished)
+        return;
+    load.finished = true;
+
+    // on_finished triggers a refresh, which may destroy other waiters, so
+    // check that each is still alive right before notifying it.
+    std::vector<std::weak_ptr<detail::route_loads>> finished_waiters;
+    for (auto const& waiter : load.waiters)
+    {
+        auto loads = waiter.lock();
+        if (loads && --loads->pending == 0)
+            finished_waiters.push_back(waiter);
+    }
+    load.waiters.clear();
+    for (auto const& waiter : finished_waiters)
+    {
+        std::function<void()> on_finished;
+        if (auto loads = waiter.lock())
+            on_finished = loads->on_finished;
+        if (on_finished)
+            on_finished();
+    }
+}
+
+} // namespace
+
+namespace detail {
+
+std::shared_ptr<route_loads>
+start_route_loads(std::string const& path, std::function<void()> on_finished)
+{
+    auto loads = std::make_shared<route_loads>();
+    loads->on_finished = std::move(on_finished);
+
+    std::vector<http_request> requests;
+    get_route_data(path, requests);
+    for (auto const& request : requests)
+    {
+        auto key = get_prefetch_key(request);
+        auto& slot = route_loads_by_key[key];
+        auto load = slot.lock();
+        if (!load)
+        {
+            load = std::make_shared<route_load>();
+            load->key = key;
+            slot = load;
+            auto* raw = load.get();
+            load->fetch = launch_fetch(
+                request,
+                [raw](http_response const& response) {
+                    finish_route_load(*raw, response);
+                },
+                fetch_priority::CRITICAL);
+        }
+        else if (!load->finished)
+        {
+            set_fetch_priority(load->fetch, fetch_priority::CRITICAL);
+        }
+        if (!load->finished)
+        {
+            load->waiters.push_back(loads);
+            ++loads->pending;
+        }
+        loads->loads.push_back(std::move(load));
+    }
+
+    return loads;
+}
+
+bool
+route_loads_finished(route_loads const& loads)
+{
+    return loads.pending == 0;
+}
+
+void
+register_route_data(char const* pattern, route_data_matcher matcher)
+{
+    for (auto& declaration : route_data_declarations)
+    {
+        if (declaration.pattern == pattern)
+        {
+            declaration.matcher = std::move(matcher);
+            return;
+        }
+    }
+    route_data_declarations.push_back(
+        route_data_declaration{pattern, std::move(matcher)});
+}
+
+void
+observe_element_visibility(int asmdom_id)
+{
+    EM_ASM(
+        {
+            var node = Module['nodes'][$0];
+            if (typeof IntersectionObserver === 'undefined')
+            {
+                // Without IntersectionObserver, there's no cheap way to tell,
+                // so assume that the element is visible.
+                setTimeout(function() {
+                    node.dispatchEvent(new CustomEvent('aliavisible'));
+                });
+                return;
+            }
+            if (!Module['aliaVisibilityObserver'])
+            {
+                Module['aliaVisibilityObserver'] = new IntersectionObserver(
+                    function(entries, observer) {
+                        entries.forEach(function(entry) {
+                            if (entry.isIntersecting)
+                            {
+                                observer.unobserve(entry.target);
+                                entry.target.dispatchEvent(
+                                    new CustomEvent('aliavisible'));
+                            }
+                        });
+                    });
+            }
+            Module['aliaVisibilityObserver'].observe(node);
+        },
+        asmdom_id);
+}
+
+} // namespace detail
+
+bool
+get_route_data(std::string const& path, std::vector<http_request>& requests)
+{
+    bool matched = false;
+    for (auto& declaration : route_data_declarations)
+    {
+        std::vector<http_request> declared;
+        if (declaration.matcher(path, declared))
+        {
+            requests.insert(requests.end(), declared.begin(), declared.end());
+            matched = true;
+        }
+    }
+    return matched;
+}
+
+void
+prefetch_route(std::string const& path, fetch_priority priority)
+{
+    std::vector<http_request> requests;
+    if (!get_route_data(path, requests))
+        return;
+
+    for (auto const& request : requests)
+    {
+        if (request.method != http_method::GET)
+            continue;
+
+        auto key = get_prefetch_key(request);
+        auto existing = active_prefetches.find(key);
+        // A prefetch whose revalidation confirmed the stale response never
+        // hears back, so clear it out here once it's done.
+        if (existing != active_prefetches.end()
+            && !fetch_in_flight(existing->second))
+        {
+            active_prefetches.erase(existing);
+            existing = active_prefetches.end();
+        }
+        if (existing != active_prefetches.end())
+        {
+            // A stronger intent can still upgrade the prefetch.
+            if (priority > get_fetch_priority(existing->second))
+                set_fetch_priority(existing->second, priority);
+            continue;
+        }
+
+        // The response itself is discarded. (It's the fetch cache's job to
+        // hold onto it.) A stale response from the cache may be delivered
+        // first, so the prefetch is only dropped once it's actually done, to
+        // let the revalidation finish.
+        active_prefetches[key] = launch_fetch(
+            request,
+            [key](http_response const&) {
+                auto prefetch = active_prefetches.find(key);
+                if (prefetch != active_prefetches.end()
+                    && !fetch_in_flight(prefetch->second))
+                {
+                    active_prefetches.erase(prefetch);
+                }
+            },
+            priority);
+    }
+}
+
+route_data_signal
+fetch_route_data(html::context ctx, readable<http_request> request)
+{
+    auto& data = get_cached_data<detail::route_data_fetch>(ctx);
+
+    refresh_handler(ctx, [&](auto ctx) {
+        data.response.refresh_container(get_active_component_container(ctx));
+        refresh_signal_view(
+            data.request_id,
+            request,
+            [&](http_request const& new_request) {
+                data.fetch.reset();
+                auto load
+                    = find_finished_route_load(get_prefetch_key(new_request));
+                if (load)
+                {
+                    data.response.set(load->response);
+                }
+                else
+                {
+                    data.response.clear();
+                    auto* system = &get<alia::system_tag>(ctx);
+                    data.fetch = launch_fetch(
+                        new_request,
+                        [&data, system](http_response const& response) {
+                            data.response.set(response);
+                            refresh_system_when_visible(*system);
+                        });
+                }
+            },
+            [&]() {
+                data.fetch.reset();
+                data.response.clear();
+            });
+    });
+
+    return route_data_signal(&data);
+}
+
+}} // namespace alia::html
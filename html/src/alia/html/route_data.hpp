@@ -0,0 +1,243 @@
+#ifndef ALIA_HTML_ROUTE_DATA_HPP
+#define ALIA_HTML_ROUTE_DATA_HPP
+
+#include <alia/html/dom.hpp>
+#include <alia/html/fetch.hpp>
+#include <alia/html/routing.hpp>
+
+#include <functional>
+#include <vector>
+
+namespace alia { namespace html {
+
+// ROUTE DATA
+//
+// Routes can declare the HTTP requests that their pages make, so that those
+// requests can be started before the page is actually rendered. In
+// particular, links can prefetch the data for their target routes as soon as
+// the user shows an intent to follow them (by hovering over them, say), so
+// the data is already there (or at least on its way) when the click happens.
+//
+// Declarations use the same patterns as router_handle::route, and the page
+// function's arguments are replaced by the route's arguments as strings:
+//
+//   declare_route_data("/users/{}", [](std::string const& id) {
+//       return std::vector<http_request>{
+//           http_request{http_method::GET, "/api/users/" + id}};
+//   });
+//
+// Unlike with the router, *every* matching declaration contributes, so a
+// parent page ('/users/{}{:/}') and a child page nested within it
+// ('/users/{}/posts/{}') can each declare their own data, and a path that
+// reaches the child loads both at once (rather than one after the other).
+// Patterns are always matched against the full path (i.e., the location
+// hash), even for pages that are rendered by nested routers.
+//
+// Prefetched responses are picked up by the page's own fetch() calls, either
+// because they're still in flight (and thus shared) or because they're in the
+// fetch cache (see fetch_cache.hpp), so the page must issue identical
+// requests, and the cache should be enabled. Only GET requests are
+// prefetched.
+//
+// ROUTE LOADERS
+//
+// The top-level router (i.e., router(ctx), which follows the location hash)
+// also treats the declarations as loaders. As soon as its path changes, it
+// starts all the declared requests for the new path with CRITICAL priority.
+// It holds off on rendering the page until they've all finished
+// (successfully or not), and the page can then get the responses through
+// fetch_route_data(), which has them on the page's very first refresh.
+//
+
+namespace detail {
+
+typedef std::function<bool(
+    std::string const& path, std::vector<http_request>& requests)>
+    route_data_matcher;
+
+// Register a matcher for the given route pattern. (This replaces any earlier
+// matcher for the same pattern.)
+void
+register_route_data(char const* pattern, route_data_matcher matcher);
+
+template<std::size_t>
+using route_data_arg_n = std::string const&;
+
+template<class Requests, std::size_t N, typename = std::make_index_sequence<N>>
+struct route_data_has_n_arity
+{
+};
+
+template<class Requests, std::size_t N, std::size_t... S>
+struct route_data_has_n_arity<Requests, N, std::index_sequence<S...>>
+    : std::is_invocable<Requests, route_data_arg_n<S>...>
+{
+};
+
+template<class Requests, std::size_t N = 0>
+struct route_data_arity
+    : std::conditional_t<
+          route_data_has_n_arity<Requests, N>::value,
+          std::integral_constant<std::size_t, N>,
+          route_data_arity<Requests, N + 1>>
+{
+};
+
+template<class Requests, std::size_t N, std::size_t... S>
+bool
+match_route_data(
+    char const* pattern,
+    Requests& requests,
+    std::string const& path,
+    std::vector<http_request>& result,
+    std::index_sequence<S...>)
+{
+    auto parse_result = route_parser<N>{pattern}(path);
+    if (!parse_result.matched)
+        return false;
+    result = requests(parse_result.arguments[S]...);
+    return true;
+}
+
+} // namespace detail
+
+// Declare the requests that a route makes.
+template<class Requests>
+void
+declare_route_data(char const* pattern, Requests requests)
+{
+    std::size_t constexpr N = detail::route_data_arity<Requests>::value;
+    detail::register_route_data(
+        pattern,
+        [pattern = std::string(pattern), requests](
+            std::string const& path,
+            std::vector<http_request>& result) mutable {
+            return detail::match_route_data<Requests, N>(
+                pattern.c_str(),
+                requests,
+                path,
+                result,
+                std::make_index_sequence<N>());
+        });
+}
+
+// Get the requests declared for the routes that match the given path.
+// Returns false if no declaration matches.
+bool
+get_route_data(std::string const& path, std::vector<http_request>& requests);
+
+// Start fetching the data declared for the routes that match the given path.
+// This does nothing for requests that are already being prefetched.
+void
+prefetch_route(
+    std::string const& path,
+    fetch_priority priority = fetch_priority::PREFETCH);
+
+// PREFETCH HINTS
+
+struct prefetch_hint
+{
+    // Prefetch when the pointer enters the element (or it gains focus or is
+    // touched).
+    bool on_hover = true;
+    // Prefetch when the element first scrolls into the viewport.
+    bool on_viewport = false;
+};
+
+namespace detail {
+
+// Start watching for the element to become visible. When it does, it's sent
+// an 'aliavisible' event (once).
+void
+observe_element_visibility(int asmdom_id);
+
+} // namespace detail
+
+// Prefetch the data for the route at the given path when the user shows an
+// intent to visit it via the given element.
+//
+// Hover intent is a strong signal, so it prefetches with VISIBLE priority.
+// Visibility prefetches are speculative and use PREFETCH priority.
+//
+template<class Element>
+Element&
+prefetch_route_on_intent(
+    Element& element,
+    readable<std::string> path,
+    prefetch_hint const& hint = prefetch_hint())
+{
+    auto prefetch = [&](fetch_priority priority) {
+        if (signal_has_value(path))
+            prefetch_route(read_signal(path), priority);
+    };
+    // The handlers are always registered (and the hint is checked when they
+    // fire), so that the component's data layout doesn't depend on the hint.
+    for (char const* event : {"mouseenter", "focus", "touchstart"})
+    {
+        element.handler(event, [&](emscripten::val) {
+            if (hint.on_hover)
+                prefetch(fetch_priority::VISIBLE);
+        });
+    }
+    if (element.initializing())
+        detail::observe_element_visibility(element.asmdom_id());
+    element.handler("aliavisible", [&](emscripten::val) {
+        if (hint.on_viewport)
+            prefetch(fetch_priority::PREFETCH);
+    });
+    return element;
+}
+
+// ROUTE DATA SIGNALS
+
+namespace detail {
+
+struct route_data_fetch : noncopyable
+{
+    captured_id request_id;
+    state_storage<http_response> response;
+    fetch_handle fetch;
+};
+
+} // namespace detail
+
+struct route_data_signal
+    : signal<route_data_signal, http_response, read_only_signal>
+{
+    explicit route_data_signal(detail::route_data_fetch* data) : data_(data)
+    {
+    }
+
+    bool
+    has_value() const override
+    {
+        return data_->response.has_value();
+    }
+
+    http_response const&
+    read() const override
+    {
+        return data_->response.get();
+    }
+
+    simple_id<unsigned> const&
+    value_id() const override
+    {
+        id_ = make_id(data_->response.version());
+        return id_;
+    }
+
+ private:
+    detail::route_data_fetch* data_;
+    mutable simple_id<unsigned> id_;
+};
+
+// Fetch the response to a request that's declared as route data.
+// If the router has already loaded it, the response is available
+// immediately. Otherwise, this falls back to a normal fetch.
+route_data_signal
+fetch_route_data(html::context ctx, readable<http_request> request);
+
+}} // namespace alia::html
+
+#endif
@@ -7,6 +7,9 @@
 
 #include <scn/scn.h>
 
+#include <functional>
+#include <memory>
+
 namespace alia { namespace html { namespace detail {
 
 // A small/experimental routing framework for alia/HTML.
@@ -188,10 +191,27 @@ struct page_arity : std::conditional_t<
 
 } // namespace detail
 
+namespace detail {
+
+// the loads of the route data for a path (See route_data.hpp.)
+struct route_loads;
+
+// Start loading the route data declared for the given path.
+// 'on_finished' is called (asynchronously) once all loads have finished.
+std::shared_ptr<route_loads>
+start_route_loads(std::string const& path, std::function<void()> on_finished);
+
+bool
+route_loads_finished(route_loads const& loads);
+
+} // namespace detail
+
 struct router_data
 {
     captured_id path_id;
     alia::state_storage<std::string> path;
+    std::shared_ptr<detail::route_loads> loads;
+    alia::state_storage<bool> loading;
 };
 
 template<class Context>
@@ -200,6 +220,9 @@ struct router_handle
     Context ctx;
     alia::state_storage<std::string>& path;
     bool already_matched;
+    // Is the router still loading the data for its path? (If so, no page is
+    // rendered.)
+    bool loading;
 
     template<class Page>
     router_handle&
@@ -208,32 +231,67 @@ struct router_handle
         std::size_t constexpr N = detail::page_arity<Page>::value;
         detail::route_parser<N> parser{pattern};
         auto parse_result = alia::apply(ctx, parser, make_state_signal(path));
+        bool skip = already_matched || loading;
         detail::page_invoker<N>::invoke(
-            ctx, std::forward<Page>(page), parse_result, already_matched);
+            ctx, std::forward<Page>(page), parse_result, skip);
+        already_matched = already_matched || skip;
         return *this;
     }
 };
 
+namespace detail {
+
 template<class Context>
 router_handle<Context>
-router(Context ctx, readable<std::string> path)
+make_router(Context ctx, readable<std::string> path, bool load_route_data)
 {
     auto& data = get_cached_data<router_data>(ctx);
+    auto* system = &get<alia::system_tag>(ctx);
     refresh_handler(ctx, [&](auto ctx) {
+        data.loading.refresh_container(get_active_component_container(ctx));
         refresh_signal_view(
             data.path_id,
             path,
-            [&](std::string const& new_value) { data.path.set(new_value); },
-            [&]() { data.path.clear(); });
+            [&](std::string const& new_value) {
+                data.path.set(new_value);
+                if (load_route_data)
+                {
+                    // The new loads are started before the old ones are
+                    // released, so any data that the two paths have in
+                    // common is kept.
+                    data.loads = start_route_loads(new_value, [&data, system] {
+                        data.loading.set(false);
+                        refresh_system_when_visible(*system);
+                    });
+                    data.loading.set(!route_loads_finished(*data.loads));
+                }
+            },
+            [&]() {
+                data.path.clear();
+                data.loads.reset();
+                data.loading.set(false);
+            });
     });
-    return router_handle<Context>{ctx, data.path, false};
+    return router_handle<Context>{
+        ctx, data.path, false, data.loading.has_value() && data.loading.get()};
+}
+
+} // namespace detail
+
+template<class Context>
+router_handle<Context>
+router(Context ctx, readable<std::string> path)
+{
+    return detail::make_router(ctx, path, false);
 }
 
+// The top-level router follows the location hash. It also runs the loaders
+// declared for its routes. (See route_data.hpp.)
 template<class Context>
 router_handle<Context>
 router(Context ctx)
 {
-    return router(
+    return detail::make_router(
         ctx,
         apply(
             ctx,
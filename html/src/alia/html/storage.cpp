@@ -144,7 +144,7 @@ get_storage_state(html::context ctx, char const* storage_name, char const* key)
                     {
                         std::cout << "storage event!" << std::endl;
                         data->value.set(event["newValue"].as<std::string>());
-                        refresh_system(*sys);
+                        refresh_system_when_visible(*sys);
                     }
                 });
         }
@@ -2,6 +2,7 @@
 
 #include <alia/html/dom.hpp>
 #include <alia/html/history.hpp>
+#include <alia/html/transitions.hpp>
 
 namespace alia { namespace html {
 
@@ -11,33 +12,111 @@ refresh_for_emscripten(void* system)
     refresh_system(*reinterpret_cast<alia::system*>(system));
 }
 
-struct timer_callback_data
+static detail::system_timer_wheel::tick_type
+get_timer_wheel_time()
 {
-    alia::system* system;
-    external_component_id component;
-    millisecond_count trigger_time;
+    return detail::system_timer_wheel::tick_type(emscripten_get_now());
+}
+
+struct native_timeout_data
+{
+    html::system* system;
+    detail::system_timers* timers;
+    detail::system_timer_wheel::tick_type deadline;
 };
 
+// Are the given timers being held back because the document is hidden?
+static bool
+timers_throttled(html::system const& sys, detail::system_timers const& timers)
+{
+    return sys.document_hidden && !timers.critical;
+}
+
+static void
+native_timeout_callback(void* user_data);
+
+// Ensure that a native timeout is armed for the earliest deadline in the
+// given timer wheel.
+static void
+arm_native_timeout(html::system& sys, detail::system_timers& timers)
+{
+    detail::system_timer_wheel::tick_type deadline;
+    if (!timers.wheel.next_deadline(&deadline))
+        return;
+    // While the document is hidden, non-critical timers are either held
+    // entirely or throttled to the system's hidden_timer_interval.
+    if (timers_throttled(sys, timers))
+    {
+        if (sys.hidden_timer_interval == 0)
+            return;
+        deadline = (std::max)(
+            deadline, timers.last_dispatch + sys.hidden_timer_interval);
+    }
+    // If there's already a timeout armed that will fire in time, there's
+    // nothing to do. (emscripten_async_call timeouts can't be cancelled, so
+    // if we arm an earlier timeout, the existing one will simply fire and
+    // find nothing to do.)
+    if (timers.armed && timers.armed_deadline <= deadline)
+        return;
+    auto now = get_timer_wheel_time();
+    timers.armed = true;
+    timers.armed_deadline = deadline;
+    emscripten_async_call(
+        native_timeout_callback,
+        new native_timeout_data{&sys, &timers, deadline},
+        deadline > now ? int(deadline - now) : 0);
+}
+
+static void
+dispatch_due_timers(html::system& sys, detail::system_timers& timers)
+{
+    auto now = get_timer_wheel_time();
+    if (timers_throttled(sys, timers)
+        && (sys.hidden_timer_interval == 0
+            || now < timers.last_dispatch + sys.hidden_timer_interval))
+    {
+        return;
+    }
+    timers.last_dispatch = now;
+    // Everything that's due within the tolerance window is dispatched now.
+    timers.wheel.advance(now + sys.timer_tolerance, [&](auto&& entry) {
+        timer_event event;
+        event.trigger_time = entry.payload.trigger_time;
+        dispatch_targeted_event(
+            sys.alia_system, event, entry.payload.component);
+    });
+}
+
 static void
-timer_callback(void* user_data)
+native_timeout_callback(void* user_data)
 {
-    std::unique_ptr<timer_callback_data> data(
-        reinterpret_cast<timer_callback_data*>(user_data));
-    timer_event event;
-    event.trigger_time = data->trigger_time;
-    dispatch_targeted_event(*data->system, event, data->component);
+    std::unique_ptr<native_timeout_data> data(
+        reinterpret_cast<native_timeout_data*>(user_data));
+    auto& sys = *data->system;
+    auto& timers = *data->timers;
+    if (timers.armed && timers.armed_deadline == data->deadline)
+        timers.armed = false;
+    dispatch_due_timers(sys, timers);
+    arm_native_timeout(sys, timers);
 }
 
 struct dom_external_interface : default_external_interface
 {
-    dom_external_interface(alia::system& owner)
-        : default_external_interface(owner)
+    dom_external_interface(html::system& owner)
+        : default_external_interface(owner.alia_system), html_system(owner)
     {
     }
 
     void
     schedule_animation_refresh()
     {
+        // If the document is hidden, just note that a refresh is needed. It
+        // will happen when the document becomes visible again.
+        if (html_system.document_hidden)
+        {
+            html_system.refresh_deferred = true;
+            return;
+        }
         emscripten_async_call(refresh_for_emscripten, &this->owner, -1);
     }
 
@@ -45,11 +124,20 @@ struct dom_external_interface : default_external_interface
     schedule_timer_event(
         external_component_id component, millisecond_count time)
     {
-        auto timeout_data
-            = new timer_callback_data{&this->owner, component, time};
-        emscripten_async_call(
-            timer_callback, timeout_data, time - this->get_tick_count());
+        // Timers that are scheduled from within a critical_timer_scope go
+        // into the wheel that's never held.
+        auto& timers = html_system.critical_timer_depth != 0
+                           ? html_system.critical_timers
+                           : html_system.timers;
+        // Convert the alia tick count to timer wheel time.
+        int delay = int(time - this->get_tick_count());
+        timers.wheel.insert(
+            get_timer_wheel_time() + (delay > 0 ? delay : 0),
+            detail::timer_request{component, time});
+        arm_native_timeout(html_system, timers);
     }
+
+    html::system& html_system;
 };
 
 void
@@ -60,6 +148,9 @@ system::operator()(alia::context vanilla_ctx)
         extend_context<tree_traversal_tag>(vanilla_ctx, traversal), *this);
 
     this->controller(ctx);
+
+    if (is_refresh_event(ctx))
+        detail::animate_list_moves();
 }
 
 void
@@ -80,8 +171,9 @@ initialize(html::system& system, std::function<void(html::context)> controller)
     initialize_system(
         system.alia_system,
         std::ref(system),
-        new dom_external_interface(system.alia_system));
+        new dom_external_interface(system));
     system.controller = std::move(controller);
+    system.critical_timers.critical = true;
 
     // Update our DOM.
     refresh_system(system.alia_system);
@@ -123,4 +215,50 @@ enable_hash_monitoring(html::system& sys)
         sys.hashchange, "hashchange", onhashchange);
 }
 
+static void
+update_document_visibility(html::system& sys)
+{
+    bool was_hidden = sys.document_hidden;
+    sys.document_hidden
+        = emscripten::val::global("document")["hidden"].as<bool>();
+    if (was_hidden && !sys.document_hidden)
+    {
+        // Catch up on everything that was deferred while we were hidden.
+        // Timer events that came due are dispatched as a single batch, and
+        // then we do one refresh to bring the DOM up-to-date.
+        dispatch_due_timers(sys, sys.timers);
+        arm_native_timeout(sys, sys.timers);
+        sys.refresh_deferred = false;
+        refresh_system(sys.alia_system);
+    }
+}
+
+void
+refresh_system_when_visible(alia::system& sys)
+{
+    // Only systems that were set up through initialize() can be hidden.
+    auto* external
+        = dynamic_cast<dom_external_interface*>(sys.external.get());
+    if (external && external->html_system.document_hidden)
+    {
+        external->html_system.refresh_deferred = true;
+        return;
+    }
+    refresh_system(sys);
+}
+
+void
+enable_visibility_monitoring(
+    html::system& sys, millisecond_count hidden_timer_interval)
+{
+    sys.hidden_timer_interval = hidden_timer_interval;
+    update_document_visibility(sys);
+    // The visibilitychange event is fired at the document, but it bubbles up
+    // to the window.
+    detail::install_window_callback(
+        sys.visibilitychange, "visibilitychange", [&sys](emscripten::val) {
+            update_document_visibility(sys);
+        });
+}
+
 }} // namespace alia::html
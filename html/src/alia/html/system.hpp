@@ -7,9 +7,36 @@
 
 #include <alia/html/context.hpp>
 #include <alia/html/dom.hpp>
+#include <alia/html/timer_wheel.hpp>
 
 namespace alia { namespace html {
 
+namespace detail {
+
+struct timer_request
+{
+    external_component_id component;
+    millisecond_count trigger_time;
+};
+
+// All timer events for a system are tracked in a single timer wheel, and a
+// single native timeout is kept armed for the earliest deadline.
+typedef timer_wheel<timer_request> system_timer_wheel;
+
+struct system_timers
+{
+    system_timer_wheel wheel;
+    // Is a native timeout currently armed, and if so, for what deadline?
+    bool armed = false;
+    system_timer_wheel::tick_type armed_deadline = 0;
+    // when timer events were last dispatched
+    system_timer_wheel::tick_type last_dispatch = 0;
+    // Critical timers are never held while the document is hidden.
+    bool critical = false;
+};
+
+} // namespace detail
+
 struct system
 {
     std::function<void(html::context)> controller;
@@ -21,6 +48,21 @@ struct system
 
     std::string hash;
     detail::window_callback hashchange;
+
+    // Timer events that are due within this many milliseconds of each other
+    // are dispatched together (from a single native timeout).
+    millisecond_count timer_tolerance = 4;
+
+    detail::system_timers timers;
+    detail::system_timers critical_timers;
+    // the nesting depth of critical_timer_scope objects
+    unsigned critical_timer_depth = 0;
+
+    // visibility monitoring - See enable_visibility_monitoring().
+    bool document_hidden = false;
+    bool refresh_deferred = false;
+    millisecond_count hidden_timer_interval = 0;
+    detail::window_callback visibilitychange;
 };
 
 // Initialize the HTML system with no root DOM element.
@@ -57,6 +99,59 @@ set_location_hash(html::system& sys, std::string new_hash);
 void
 enable_hash_monitoring(html::system& sys);
 
+// Install an event handler to monitor the visibility of the document.
+//
+// While the document is hidden (e.g., because the app is in a background tab),
+// refreshes (including those requested through refresh_system_when_visible()
+// by asynchronous completions) are deferred and timer events are held, except
+// for critical ones. (See critical_timer_scope.) When the document becomes
+// visible again, any timer events that came due in the meantime are
+// dispatched together, followed by a single catch-up refresh.
+//
+// If 'hidden_timer_interval' is nonzero, timer events aren't held indefinitely
+// while the document is hidden. Instead, they're dispatched (in batches) at
+// most once per interval. This is useful if some background activity (e.g.,
+// polling) needs to continue, albeit at a slower pace.
+//
+void
+enable_visibility_monitoring(
+    html::system& sys, millisecond_count hidden_timer_interval = 0);
+
+// Timer events that are scheduled by code within a critical_timer_scope
+// (e.g., alia timers that are created and started there) are critical: they
+// keep firing on time while the document is hidden. Use this sparingly, for
+// things like session keep-alives that can't wait for the user to come back.
+//
+struct critical_timer_scope : noncopyable
+{
+    explicit critical_timer_scope(html::system& sys) : sys_(sys)
+    {
+        ++sys_.critical_timer_depth;
+    }
+    explicit critical_timer_scope(html::context ctx)
+        : critical_timer_scope(get<system_tag>(ctx))
+    {
+    }
+    ~critical_timer_scope()
+    {
+        --sys_.critical_timer_depth;
+    }
+
+ private:
+    html::system& sys_;
+};
+
+// Is the document associated with the HTML system currently hidden?
+//
+// Note that this is only tracked if enable_visibility_monitoring() has been
+// called on the system.
+//
+inline bool
+is_document_hidden(html::system const& sys)
+{
+    return sys.document_hidden;
+}
+
 // Manually update the location hash.
 // If no hash is currently present, navigate to '#/'.
 void
@@ -0,0 +1,227 @@
+#ifndef ALIA_HTML_TIMER_WHEEL_HPP
+#define ALIA_HTML_TIMER_WHEEL_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace alia { namespace html { namespace detail {
+
+// timer_wheel is a hierarchical timing wheel that stores pending timer
+// requests (with arbitrary payloads) and efficiently determines which are due.
+//
+// Time is measured in integer ticks (milliseconds, as used by html::system).
+//
+// The wheel has several levels, each with 64 slots. A slot at level N covers
+// 64^N ticks. Entries are placed at the lowest level where their deadline
+// shares all higher-order digits with the current time, so within a level,
+// the occupied slots are always in deadline order and any entry at a lower
+// level is due before any entry at a higher level. This makes it cheap to
+// find the next deadline (which is what drives the single native timeout).
+//
+// Each level also keeps a bit mask of its occupied slots so that advancing
+// the wheel across long idle periods skips empty slots rather than stepping
+// through them.
+//
+template<class Payload>
+struct timer_wheel
+{
+    typedef std::uint64_t tick_type;
+
+    struct entry
+    {
+        tick_type deadline;
+        Payload payload;
+    };
+
+    // Get the time that the wheel has been advanced to.
+    tick_type
+    now() const
+    {
+        return current_;
+    }
+
+    bool
+    empty() const
+    {
+        return size_ == 0;
+    }
+
+    std::size_t
+    size() const
+    {
+        return size_;
+    }
+
+    // Add an entry.
+    // Deadlines in the past are fine. They're reported on the next call to
+    // advance().
+    void
+    insert(tick_type deadline, Payload payload)
+    {
+        place(entry{deadline, std::move(payload)});
+        ++size_;
+    }
+
+    // Query the earliest deadline of any entry.
+    // Returns false if the wheel is empty.
+    bool
+    next_deadline(tick_type* deadline) const
+    {
+        for (unsigned level = 0; level != level_count; ++level)
+        {
+            if (occupied_[level] != 0)
+            {
+                auto const& slot
+                    = slots_[level][lowest_bit(occupied_[level])];
+                *deadline = earliest_in(slot);
+                return true;
+            }
+        }
+        if (!overflow_.empty())
+        {
+            *deadline = earliest_in(overflow_);
+            return true;
+        }
+        return false;
+    }
+
+    // Advance the wheel to the time 'now', removing all entries that are due
+    // by then and passing them (in deadline order) to 'handler'.
+    //
+    // 'handler' is free to insert new entries.
+    //
+    template<class Handler>
+    void
+    advance(tick_type now, Handler&& handler)
+    {
+        std::vector<entry> due;
+
+        while (true)
+        {
+            unsigned level = 0;
+            while (level != level_count && occupied_[level] == 0)
+                ++level;
+            if (level == level_count)
+                break;
+
+            unsigned slot_index = lowest_bit(occupied_[level]);
+            tick_type slot_start = slot_start_time(level, slot_index);
+            if (slot_start > now)
+                break;
+
+            std::vector<entry> entries;
+            std::swap(entries, slots_[level][slot_index]);
+            occupied_[level] &= ~(std::uint64_t(1) << slot_index);
+
+            // Moving the current time to the start of the slot means that
+            // any entries that aren't due yet will now cascade down to lower
+            // levels.
+            current_ = (std::max)(current_, slot_start);
+            for (auto& e : entries)
+            {
+                if (e.deadline <= now)
+                    due.push_back(std::move(e));
+                else
+                    place(std::move(e));
+            }
+        }
+
+        current_ = (std::max)(current_, now);
+
+        // Re-place any overflow entries that are due or now fit in the wheel.
+        if (!overflow_.empty())
+        {
+            std::vector<entry> overflow;
+            std::swap(overflow, overflow_);
+            for (auto& e : overflow)
+            {
+                if (e.deadline <= now)
+                    due.push_back(std::move(e));
+                else
+                    place(std::move(e));
+            }
+        }
+
+        size_ -= due.size();
+
+        std::stable_sort(
+            due.begin(), due.end(), [](entry const& a, entry const& b) {
+                return a.deadline < b.deadline;
+            });
+        for (auto& e : due)
+            handler(std::move(e));
+    }
+
+ private:
+    static constexpr unsigned slot_bits = 6;
+    static constexpr unsigned slot_count = 1 << slot_bits;
+    static constexpr unsigned level_count = 6;
+
+    static unsigned
+    lowest_bit(std::uint64_t mask)
+    {
+        return unsigned(__builtin_ctzll(mask));
+    }
+
+    static tick_type
+    earliest_in(std::vector<entry> const& entries)
+    {
+        tick_type earliest = entries.front().deadline;
+        for (auto const& e : entries)
+            earliest = (std::min)(earliest, e.deadline);
+        return earliest;
+    }
+
+    tick_type
+    slot_start_time(unsigned level, unsigned slot_index) const
+    {
+        unsigned shift = slot_bits * (level + 1);
+        tick_type base = shift < 64 ? (current_ >> shift) << shift : 0;
+        return base | (tick_type(slot_index) << (slot_bits * level));
+    }
+
+    void
+    place(entry e)
+    {
+        if (e.deadline <= current_)
+        {
+            add_to_slot(
+                0, unsigned(current_ & (slot_count - 1)), std::move(e));
+            return;
+        }
+        // The level is determined by the most significant digit in which the
+        // deadline differs from the current time.
+        std::uint64_t differences
+            = (e.deadline ^ current_) | (slot_count - 1);
+        unsigned level
+            = unsigned(63 - __builtin_clzll(differences)) / slot_bits;
+        if (level >= level_count)
+        {
+            overflow_.push_back(std::move(e));
+            return;
+        }
+        unsigned slot_index
+            = unsigned(e.deadline >> (slot_bits * level)) & (slot_count - 1);
+        add_to_slot(level, slot_index, std::move(e));
+    }
+
+    void
+    add_to_slot(unsigned level, unsigned slot_index, entry e)
+    {
+        slots_[level][slot_index].push_back(std::move(e));
+        occupied_[level] |= std::uint64_t(1) << slot_index;
+    }
+
+    tick_type current_ = 0;
+    std::size_t size_ = 0;
+    std::vector<entry> slots_[level_count][slot_count];
+    std::uint64_t occupied_[level_count] = {};
+    // entries too far in the future to fit in the wheel
+    std::vector<entry> overflow_;
+};
+
+}}} // namespace alia::html::detail
+
+#endif
@@ -0,0 +1,207 @@
+#include <alia/html/transitions.hpp>
+
+#include <emscripten/emscripten.h>
+
+namespace alia { namespace html {
+
+namespace detail {
+
+// Have any lists with transitions been created?
+static bool list_transitions_enabled = false;
+
+static void
+install_list_transition_handlers()
+{
+    static bool installed = false;
+    if (installed)
+        return;
+
+    EM_ASM({
+        var animate = function(node, keyframes, config)
+        {
+            return node.animate(
+                keyframes,
+                {duration : config.duration, easing : config.easing});
+        };
+
+        Module['aliaListContainers'] = [];
+
+        Module['aliaInsertIntoList'] = function(parent, node, before)
+        {
+            var config = parent.aliaListTransition;
+            var leaving = node.aliaLeaving;
+            var entering = leaving || node.parentNode !== parent;
+            // If the node is coming back while it's still leaving, abort the
+            // removal.
+            if (leaving)
+            {
+                node.aliaLeaving = null;
+                leaving.cancel();
+            }
+            parent.insertBefore(node, before);
+            if (entering && config.enter && node.animate
+                && (config.ready || config.appear))
+            {
+                animate(node, config.enter, config);
+            }
+        };
+
+        Module['aliaRemoveFromList'] = function(node)
+        {
+            var parent = node.parentNode;
+            var config = parent && parent.aliaListTransition;
+            if (!config || !config.leave || !node.animate)
+                return false;
+            var animation = animate(node, config.leave, config);
+            node.aliaLeaving = animation;
+            animation.onfinish = function()
+            {
+                node.aliaLeaving = null;
+                if (node.parentNode)
+                    node.parentNode.removeChild(node);
+                // The node's siblings may need to move into the space it
+                // occupied.
+                Module['aliaAnimateListMoves']();
+            };
+            return true;
+        };
+
+        Module['aliaAnimateListMoves'] = function()
+        {
+            // Read the layout positions of all children first, so that
+            // layout is only computed once.
+            var containers = Module['aliaListContainers'];
+            var measurements = [];
+            for (var i = 0; i < containers.length;)
+            {
+                var container = containers[i];
+                if (!container.isConnected)
+                {
+                    containers.splice(i, 1);
+                    continue;
+                }
+                var children = container.children;
+                for (var j = 0; j < children.length; ++j)
+                {
+                    var child = children[j];
+                    var x = child.offsetLeft;
+                    var y = child.offsetTop;
+                    if (child.offsetParent !== container)
+                    {
+                        x -= container.offsetLeft;
+                        y -= container.offsetTop;
+                    }
+                    measurements.push([ child, container, x, y ]);
+                }
+                ++i;
+            }
+
+            // Now animate any children that have moved.
+            for (var i = 0; i < measurements.length; ++i)
+            {
+                var child = measurements[i][0];
+                var config = measurements[i][1].aliaListTransition;
+                var x = measurements[i][2];
+                var y = measurements[i][3];
+                var previous = child.aliaListPosition;
+                child.aliaListPosition = [ x, y ];
+                if (!config.move || !previous || child.aliaLeaving
+                    || !child.animate)
+                {
+                    continue;
+                }
+                var dx = previous[0] - x;
+                var dy = previous[1] - y;
+                if (dx === 0 && dy === 0)
+                    continue;
+                if (child.aliaMoving)
+                    child.aliaMoving.cancel();
+                child.aliaMoving = animate(
+                    child,
+                    [
+                        {transform : 'translate(' + dx + 'px, ' + dy + 'px)'},
+                        {transform : 'none'}
+                    ],
+                    config);
+            }
+
+            for (var i = 0; i < containers.length; ++i)
+                containers[i].aliaListTransition.ready = true;
+        };
+    });
+
+    installed = true;
+}
+
+void
+enable_list_transitions(
+    element_object& object, list_transition const& transition)
+{
+    install_list_transition_handlers();
+    object.has_list_transitions = true;
+    EM_ASM(
+        {
+            var parse = function(keyframes)
+            {
+                var text = Module['UTF8ToString'](keyframes);
+                return text ? JSON.parse(text) : null;
+            };
+            var node = Module['nodes'][$0];
+            node.aliaListTransition = {
+                enter : parse($1),
+                leave : parse($2),
+                duration : $3,
+                easing : Module['UTF8ToString']($4),
+                move : $5 != 0,
+                appear : $6 != 0,
+                ready : false
+            };
+            Module['aliaListContainers'].push(node);
+        },
+        object.asmdom_id,
+        transition.enter,
+        transition.leave,
+        transition.duration,
+        transition.easing,
+        transition.move,
+        transition.appear);
+    list_transitions_enabled = true;
+}
+
+void
+insert_into_transitioning_list(int parent_id, int child_id, int before_id)
+{
+    EM_ASM(
+        {
+            var nodes = Module['nodes'];
+            Module['aliaInsertIntoList'](
+                nodes[$0], nodes[$1], $2 != 0 ? nodes[$2] : null);
+        },
+        parent_id,
+        child_id,
+        before_id);
+}
+
+bool
+remove_from_transitioning_list(int asmdom_id)
+{
+    return EM_ASM_INT(
+               {
+                   return Module['aliaRemoveFromList'](Module['nodes'][$0])
+                              ? 1
+                              : 0;
+               },
+               asmdom_id)
+           != 0;
+}
+
+void
+animate_list_moves()
+{
+    if (list_transitions_enabled)
+        EM_ASM({ Module['aliaAnimateListMoves'](); });
+}
+
+} // namespace detail
+
+}} // namespace alia::html
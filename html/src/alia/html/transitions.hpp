@@ -0,0 +1,75 @@
+#ifndef ALIA_HTML_TRANSITIONS_HPP
+#define ALIA_HTML_TRANSITIONS_HPP
+
+#include <alia/html/context.hpp>
+#include <alia/html/dom.hpp>
+
+namespace alia { namespace html {
+
+// LIST TRANSITIONS
+//
+// Enabling list transitions on an element animates the comings and goings of
+// its children:
+//
+// - Children that are added play an 'enter' animation.
+//
+// - Children that are removed are detached from the object tree as usual, but
+//   they stay in the DOM until their 'leave' animation finishes. (So the app
+//   doesn't need to keep any 'zombie' state around for them.)
+//
+// - Children that change position (due to reordering or to siblings coming
+//   and going) smoothly move to their new positions. These moves are computed
+//   FLIP-style. After each refresh, the positions of the children of all
+//   transitioning lists are read in a single pass (so layout is only
+//   computed once), and then the moves are animated with transforms.
+//
+// All animations are done via the Web Animations API. In browsers that don't
+// support it, children simply appear and disappear immediately.
+//
+
+struct list_transition
+{
+    // the keyframes (as JSON, in Web Animations format) for entering and
+    // leaving children - An empty string disables the animation.
+    char const* enter = "[{\"opacity\": 0}, {\"opacity\": 1}]";
+    char const* leave = "[{\"opacity\": 1}, {\"opacity\": 0}]";
+
+    millisecond_count duration = 200;
+
+    // a CSS easing function
+    char const* easing = "ease";
+
+    // Should children animate when they move to new positions?
+    bool move = true;
+
+    // Should the initial children of the list play their enter animations?
+    bool appear = false;
+};
+
+namespace detail {
+
+void
+enable_list_transitions(
+    element_object& object, list_transition const& transition);
+
+// Animate any moves within transitioning lists.
+// This is called by the HTML system after each refresh.
+void
+animate_list_moves();
+
+} // namespace detail
+
+// Enable list transitions on the children of an element.
+template<class Element>
+Element&
+list_transitions(
+    Element& element, list_transition const& transition = list_transition())
+{
+    if (element.initializing())
+        detail::enable_list_transitions(element.node().object, transition);
+    return element;
+}
+
+}} // namespace alia::html
+
+#endif
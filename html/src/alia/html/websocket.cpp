@@ -0,0 +1,481 @@
+#include <alia/html/websocket.hpp>
+
+#include <emscripten/bind.h>
+#include <emscripten/emscripten.h>
+
+#include <cstdlib>
+#include <deque>
+#include <unordered_map>
+
+namespace alia { namespace html {
+
+namespace detail {
+
+namespace {
+
+enum websocket_event
+{
+    WEBSOCKET_OPENED,
+    WEBSOCKET_CLOSED
+};
+
+} // namespace
+
+struct outgoing_message
+{
+    std::vector<char> bytes;
+    bool is_text;
+};
+
+struct websocket_state : std::enable_shared_from_this<websocket_state>
+{
+    // the component data that owns this connection - This is cleared when the
+    // connection is abandoned, at which point nothing else should be done.
+    websocket_data* owner = nullptr;
+
+    alia::system* system = nullptr;
+
+    // the ID of the socket on the JS side (or 0 if there's no open socket)
+    int id = 0;
+
+    std::string url;
+    websocket_options options;
+    websocket_handler handler;
+
+    websocket_info info;
+
+    // the messages that haven't been delivered yet
+    std::vector<websocket_message> inbox;
+
+    std::deque<outgoing_message> outbox;
+
+    bool delivery_scheduled = false;
+    bool pump_scheduled = false;
+};
+
+namespace {
+
+// the open sockets, by ID
+std::unordered_map<int, std::weak_ptr<websocket_state>> open_sockets;
+int next_socket_id = 1;
+
+std::shared_ptr<websocket_state>
+find_socket(int id)
+{
+    auto i = open_sockets.find(id);
+    return i != open_sockets.end() ? i->second.lock() : nullptr;
+}
+
+void
+deliver_messages(void* arg);
+
+// Schedule delivery of the inbox (and the current info) for the next
+// animation frame.
+void
+schedule_delivery(websocket_state& state)
+{
+    if (!state.delivery_scheduled)
+    {
+        state.delivery_scheduled = true;
+        emscripten_async_call(
+            deliver_messages,
+            new std::shared_ptr<websocket_state>(state.shared_from_this()),
+            -1);
+    }
+}
+
+void
+deliver_messages(void* arg)
+{
+    std::unique_ptr<std::shared_ptr<websocket_state>> holder(
+        reinterpret_cast<std::shared_ptr<websocket_state>*>(arg));
+    auto& state = **holder;
+    state.delivery_scheduled = false;
+    if (!state.owner)
+        return;
+
+    if (!state.inbox.empty())
+    {
+        std::vector<websocket_message> messages;
+        std::swap(messages, state.inbox);
+        if (state.handler)
+            state.handler(messages);
+        // The handler isn't supposed to touch the component tree, but be
+        // careful anyway.
+        if (!state.owner)
+            return;
+    }
+
+    state.owner->info.set(state.info);
+    refresh_system_when_visible(*state.system);
+}
+
+void
+close_socket(websocket_state& state)
+{
+    if (state.id == 0)
+        return;
+    EM_ASM(
+        {
+            var ws = Module['aliaWebSockets'][$0];
+            delete Module['aliaWebSockets'][$0];
+            ws.onopen = ws.onclose = ws.onmessage = null;
+            ws.close();
+        },
+        state.id);
+    open_sockets.erase(state.id);
+    state.id = 0;
+}
+
+void
+open_socket(websocket_state& state)
+{
+    state.id = next_socket_id++;
+    open_sockets[state.id] = state.shared_from_this();
+    state.info.status = websocket_status::CONNECTING;
+    state.info.close_code = 0;
+
+    std::string protocols;
+    for (auto const& protocol : state.options.protocols)
+    {
+        if (!protocols.empty())
+            protocols += ",";
+        protocols += protocol;
+    }
+
+    EM_ASM(
+        {
+            if (!('aliaWebSockets' in Module))
+                Module['aliaWebSockets'] = {};
+            var id = $0;
+            var url = Module['UTF8ToString']($1);
+            var protocols = Module['UTF8ToString']($2);
+            var ws;
+            try
+            {
+                ws = protocols ? new WebSocket(url, protocols.split(','))
+                               : new WebSocket(url);
+            }
+            catch (e)
+            {
+                // Report invalid URLs like any other failed connection.
+                setTimeout(function() {
+                    Module.websocket_event_proxy(id, 1, 1006);
+                });
+                ws = {close : function(){}};
+                Module['aliaWebSockets'][id] = ws;
+                return;
+            }
+            Module['aliaWebSockets'][id] = ws;
+            ws.binaryType = 'arraybuffer';
+            ws.onopen = function()
+            {
+                Module.websocket_event_proxy(id, 0, 0);
+            };
+            ws.onclose = function(e)
+            {
+                Module.websocket_event_proxy(id, 1, e.code);
+            };
+            ws.onmessage = function(e)
+            {
+                // Copy the message straight into wasm memory. (Text is
+                // encoded directly into it.) The C++ side takes ownership of
+                // the buffer.
+                var buffer;
+                var length;
+                if (typeof e.data === 'string')
+                {
+                    length = Module['lengthBytesUTF8'](e.data);
+                    // (stringToUTF8 also writes a terminator.)
+                    buffer = Module.websocket_allocate(length + 1);
+                    Module['stringToUTF8'](e.data, buffer, length + 1);
+                    Module.websocket_message_proxy(id, buffer, length, true);
+                }
+                else
+                {
+                    var bytes = new Uint8Array(e.data);
+                    length = bytes.length;
+                    buffer = Module.websocket_allocate(length);
+                    HEAPU8.set(bytes, buffer);
+                    Module.websocket_message_proxy(id, buffer, length, false);
+                }
+            };
+        },
+        state.id,
+        state.url.c_str(),
+        protocols.c_str());
+}
+
+void
+pump_outbox(websocket_state& state);
+
+void
+pump_callback(void* arg)
+{
+    std::unique_ptr<std::shared_ptr<websocket_state>> holder(
+        reinterpret_cast<std::shared_ptr<websocket_state>*>(arg));
+    auto& state = **holder;
+    state.pump_scheduled = false;
+    if (!state.owner)
+        return;
+    auto queued_before = state.info.queued_bytes;
+    pump_outbox(state);
+    if (state.info.queued_bytes != queued_before)
+        schedule_delivery(state);
+}
+
+// Pass queued messages to the browser for as long as its send buffer is
+// below the high-water mark.
+void
+pump_outbox(websocket_state& state)
+{
+    while (!state.outbox.empty()
+           && state.info.status == websocket_status::OPEN)
+    {
+        int buffered = EM_ASM_INT(
+            { return Module['aliaWebSockets'][$0].bufferedAmount; },
+            state.id);
+        if (std::size_t(buffered) >= state.options.high_water_mark)
+        {
+            // The browser doesn't tell us when its buffer drains, so check
+            // back shortly.
+            if (!state.pump_scheduled)
+            {
+                state.pump_scheduled = true;
+                emscripten_async_call(
+                    pump_callback,
+                    new std::shared_ptr<websocket_state>(
+                        state.shared_from_this()),
+                    16);
+            }
+            break;
+        }
+        auto& message = state.outbox.front();
+        EM_ASM(
+            {
+                // The browser copies what it's given, so a view into wasm
+                // memory suffices (unless that memory is shared, which
+                // send() and decode() don't accept).
+                var bytes = HEAPU8.subarray($1, $1 + $2);
+                if (!(HEAPU8.buffer instanceof ArrayBuffer))
+                    bytes = bytes.slice();
+                if (!Module['aliaTextDecoder'])
+                    Module['aliaTextDecoder'] = new TextDecoder();
+                Module['aliaWebSockets'][$0].send(
+                    $3 ? Module['aliaTextDecoder'].decode(bytes) : bytes);
+            },
+            state.id,
+            message.bytes.data(),
+            message.bytes.size(),
+            message.is_text);
+        state.info.queued_bytes -= message.bytes.size();
+        state.outbox.pop_front();
+    }
+    state.info.send_queue_full
+        = state.info.queued_bytes >= state.options.max_queued_bytes;
+}
+
+void
+reconnect_callback(void* arg)
+{
+    std::unique_ptr<std::shared_ptr<websocket_state>> holder(
+        reinterpret_cast<std::shared_ptr<websocket_state>*>(arg));
+    auto& state = **holder;
+    if (!state.owner || state.id != 0)
+        return;
+    open_socket(state);
+    schedule_delivery(state);
+}
+
+std::uintptr_t
+allocate_websocket_buffer(std::size_t size)
+{
+    return reinterpret_cast<std::uintptr_t>(std::malloc(size != 0 ? size : 1));
+}
+
+void
+handle_websocket_message(
+    int id, std::uintptr_t buffer, std::size_t size, bool is_text)
+{
+    // Take ownership of the buffer first, so that it's freed even if the
+    // socket is gone.
+    std::shared_ptr<char> owner(reinterpret_cast<char*>(buffer), std::free);
+    auto state = find_socket(id);
+    if (!state)
+        return;
+    state->inbox.push_back(
+        websocket_message{blob{owner.get(), size, owner}, is_text});
+    ++state->info.messages_received;
+    state->info.bytes_received += size;
+    schedule_delivery(*state);
+}
+
+void
+handle_websocket_event(int id, int event, int code)
+{
+    auto state = find_socket(id);
+    if (!state)
+        return;
+    switch (event)
+    {
+        case WEBSOCKET_OPENED:
+            state->info.status = websocket_status::OPEN;
+            pump_outbox(*state);
+            break;
+        case WEBSOCKET_CLOSED:
+            close_socket(*state);
+            state->info.status = websocket_status::CLOSED;
+            state->info.close_code = code;
+            if (state->options.reconnect_delay != 0)
+            {
+                emscripten_async_call(
+                    reconnect_callback,
+                    new std::shared_ptr<websocket_state>(state),
+                    int(state->options.reconnect_delay));
+            }
+            else
+            {
+                // Nothing queued will ever be sent.
+                state->outbox.clear();
+                state->info.queued_bytes = 0;
+                state->info.send_queue_full = false;
+            }
+            break;
+    }
+    schedule_delivery(*state);
+}
+
+} // namespace
+
+EMSCRIPTEN_BINDINGS(websocket_proxies)
+{
+    emscripten::function("websocket_allocate", &allocate_websocket_buffer);
+    emscripten::function(
+        "websocket_message_proxy", &handle_websocket_message);
+    emscripten::function("websocket_event_proxy", &handle_websocket_event);
+};
+
+static void
+abandon_websocket(websocket_data& data)
+{
+    if (!data.state)
+        return;
+    auto& state = *data.state;
+    state.owner = nullptr;
+    state.handler = nullptr;
+    state.inbox.clear();
+    state.outbox.clear();
+    close_socket(state);
+    data.state.reset();
+}
+
+websocket_data::~websocket_data()
+{
+    abandon_websocket(*this);
+}
+
+static void
+start_websocket(
+    websocket_data& data,
+    alia::system& system,
+    std::string const& url,
+    websocket_options const& options)
+{
+    auto state = std::make_shared<websocket_state>();
+    state->owner = &data;
+    state->system = &system;
+    state->url = url;
+    state->options = options;
+    open_socket(*state);
+    data.info.set(state->info);
+    data.state = std::move(state);
+}
+
+static bool
+websocket_accepting(websocket_state const& state)
+{
+    return state.info.status != websocket_status::CLOSED
+           || state.options.reconnect_delay != 0;
+}
+
+bool
+websocket_can_send(websocket_data const& data, std::size_t size)
+{
+    auto const* state = data.state.get();
+    if (!state || !websocket_accepting(*state))
+        return false;
+    // A single oversized message is accepted as long as the queue is empty.
+    return state->outbox.empty()
+           || state->info.queued_bytes + size
+                  <= state->options.max_queued_bytes;
+}
+
+bool
+websocket_ready_to_send(websocket_data const& data)
+{
+    // This agrees with send_queue_full: once the queue is full, not even the
+    // smallest message fits.
+    auto const* state = data.state.get();
+    return state && websocket_accepting(*state)
+           && state->info.queued_bytes < state->options.max_queued_bytes;
+}
+
+bool
+send_websocket_message(
+    websocket_data& data, char const* bytes, std::size_t size, bool is_text)
+{
+    if (!websocket_can_send(data, size))
+    {
+        if (data.state)
+        {
+            ++data.state->info.messages_dropped;
+            schedule_delivery(*data.state);
+        }
+        return false;
+    }
+    auto& state = *data.state;
+    state.outbox.push_back(
+        outgoing_message{std::vector<char>(bytes, bytes + size), is_text});
+    state.info.queued_bytes += size;
+    pump_outbox(state);
+    schedule_delivery(state);
+    return true;
+}
+
+} // namespace detail
+
+websocket_signal
+websocket(
+    html::context ctx,
+    readable<std::string> url,
+    websocket_handler handler,
+    websocket_options const& options)
+{
+    auto& data = get_cached_data<detail::websocket_data>(ctx);
+
+    refresh_handler(ctx, [&](auto ctx) {
+        data.info.refresh_container(get_active_component_container(ctx));
+        refresh_signal_view(
+            data.url_id,
+            url,
+            [&](std::string const& new_url) {
+                detail::abandon_websocket(data);
+                detail::start_websocket(
+                    data, get<alia::system_tag>(ctx), new_url, options);
+            },
+            [&]() {
+                detail::abandon_websocket(data);
+                data.info.clear();
+            });
+        if (data.state)
+        {
+            data.state->handler = std::move(handler);
+            // (The protocols only matter when connecting.)
+            data.state->options = options;
+        }
+    });
+
+    return websocket_signal(&data);
+}
+
+}} // namespace alia::html
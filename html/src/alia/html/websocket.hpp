@@ -0,0 +1,220 @@
+#ifndef ALIA_HTML_WEBSOCKET_HPP
+#define ALIA_HTML_WEBSOCKET_HPP
+
+#include <alia/html/context.hpp>
+#include <alia/html/fetch.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace alia { namespace html {
+
+// WEBSOCKETS
+//
+// websocket() maintains a WebSocket connection for as long as the calling
+// component is around (and its URL has a value).
+//
+// Incoming messages are copied from the browser straight into wasm memory
+// (one copy, with no intermediate JS array - text is UTF-8 encoded directly
+// into the buffer). Messages that arrive in bursts are collected and handed
+// to the app's handler together, once per animation frame, and the app is
+// refreshed once after that, so a flood of updates (e.g., market data) costs
+// one refresh per frame rather than one per message.
+//
+// Outgoing messages go through a bounded queue. Messages are passed to the
+// browser only while its own send buffer (the socket's bufferedAmount) is
+// below a high-water mark, so a slow connection backs up into the queue, and
+// once the queue is full, sending fails (and the send actions report that
+// they're not ready). The signal reports how much is queued.
+//
+// scripts/run-websocket-echo-server.py provides a local echo server to test
+// against.
+//
+
+enum class websocket_status
+{
+    CONNECTING,
+    OPEN,
+    // The connection closed (or failed). If reconnection is enabled, it goes
+    // back to CONNECTING after the delay.
+    CLOSED
+};
+
+struct websocket_info
+{
+    websocket_status status = websocket_status::CONNECTING;
+    // the close code from the server, if the connection closed
+    int close_code = 0;
+    std::uint64_t messages_received = 0;
+    std::uint64_t bytes_received = 0;
+    // the number of bytes waiting in the send queue (not counting what the
+    // browser has buffered)
+    std::size_t queued_bytes = 0;
+    // Is the send queue too full to accept another message?
+    bool send_queue_full = false;
+    // the number of outgoing messages that were refused (because the
+    // connection was closed or the queue was full)
+    std::uint64_t messages_dropped = 0;
+};
+
+struct websocket_message
+{
+    // For text messages, this is UTF-8.
+    blob data;
+    bool is_text = false;
+
+    std::string_view
+    text() const
+    {
+        return std::string_view(data.data, std::size_t(data.size));
+    }
+};
+
+// The handler is called outside of refreshes (just before the refresh for
+// the frame), with all the messages that arrived since the last call, in
+// order.
+typedef std::function<void(std::vector<websocket_message> const& messages)>
+    websocket_handler;
+
+struct websocket_options
+{
+    std::vector<std::string> protocols;
+    // the maximum number of bytes that can wait in the send queue
+    std::size_t max_queued_bytes = 1024 * 1024;
+    // Messages are held in the queue while the browser has at least this many
+    // bytes buffered for sending.
+    std::size_t high_water_mark = 256 * 1024;
+    // If this is nonzero, closed connections are reopened after this delay.
+    millisecond_count reconnect_delay = 0;
+};
+
+namespace detail {
+
+struct websocket_state;
+
+struct websocket_data : noncopyable
+{
+    ~websocket_data();
+
+    captured_id url_id;
+    std::shared_ptr<websocket_state> state;
+    state_storage<websocket_info> info;
+};
+
+bool
+send_websocket_message(
+    websocket_data& data, char const* bytes, std::size_t size, bool is_text);
+
+bool
+websocket_can_send(websocket_data const& data, std::size_t size);
+
+// Can the connection accept a (small) message right now?
+bool
+websocket_ready_to_send(websocket_data const& data);
+
+} // namespace detail
+
+struct websocket_signal
+    : signal<websocket_signal, websocket_info, read_only_signal>
+{
+    explicit websocket_signal(detail::websocket_data* data) : data_(data)
+    {
+    }
+
+    bool
+    has_value() const override
+    {
+        return data_->info.has_value();
+    }
+
+    websocket_info const&
+    read() const override
+    {
+        return data_->info.get();
+    }
+
+    simple_id<unsigned> const&
+    value_id() const override
+    {
+        id_ = make_id(data_->info.version());
+        return id_;
+    }
+
+    detail::websocket_data*
+    data() const
+    {
+        return data_;
+    }
+
+ private:
+    detail::websocket_data* data_;
+    mutable simple_id<unsigned> id_;
+};
+
+// Connect to the WebSocket server at 'url'.
+// The returned signal carries the state of the connection. (It has no value
+// while there's no URL.) Changing the URL closes the current connection and
+// opens a new one.
+websocket_signal
+websocket(
+    html::context ctx,
+    readable<std::string> url,
+    websocket_handler handler,
+    websocket_options const& options = websocket_options());
+
+// Send a message over a connection (outside of the signal graph).
+// Messages sent while the connection is still opening are queued.
+// Returns false (and drops the message) if the connection is closed or the
+// send queue is full.
+inline bool
+websocket_send(websocket_signal const& socket, std::string_view text)
+{
+    return detail::send_websocket_message(
+        *socket.data(), text.data(), text.size(), true);
+}
+inline bool
+websocket_send(websocket_signal const& socket, blob const& message)
+{
+    return detail::send_websocket_message(
+        *socket.data(),
+        message.data,
+        std::size_t(message.size),
+        false);
+}
+
+// Get an action that sends text messages over a connection.
+// The action is only ready while the connection can accept a message. (A
+// message that's too big for the remaining queue space is still dropped and
+// counted in the signal's messages_dropped.)
+inline auto
+websocket_send_text(websocket_signal const& socket)
+{
+    auto* data = socket.data();
+    return callback(
+        [data]() { return detail::websocket_ready_to_send(*data); },
+        [data](std::string text) {
+            detail::send_websocket_message(
+                *data, text.data(), text.size(), true);
+        });
+}
+
+// Get an action that sends binary messages over a connection.
+inline auto
+websocket_send_binary(websocket_signal const& socket)
+{
+    auto* data = socket.data();
+    return callback(
+        [data]() { return detail::websocket_ready_to_send(*data); },
+        [data](blob message) {
+            detail::send_websocket_message(
+                *data, message.data, std::size_t(message.size), false);
+        });
+}
+
+}} // namespace alia::html
+
+#endif
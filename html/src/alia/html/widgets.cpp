@@ -1,5 +1,7 @@
 #include <alia/html/widgets.hpp>
 
+#include <alia/html/route_data.hpp>
+
 namespace alia { namespace html {
 
 input_handle&
@@ -86,6 +88,32 @@ link(html::context ctx, readable<std::string> text, readable<std::string> href)
         .text(text);
 }
 
+element_handle
+link(
+    html::context ctx,
+    readable<std::string> text,
+    readable<std::string> href,
+    prefetch_hint const& hint)
+{
+    // Only hash routes can be prefetched.
+    auto route = mask(
+        apply(
+            ctx,
+            [](std::string const& href) {
+                return href.empty() ? href : href.substr(1);
+            },
+            href),
+        apply(
+            ctx,
+            [](std::string const& href) {
+                return !href.empty() && href[0] == '#';
+            },
+            href));
+    auto handle = link(ctx, text, href);
+    prefetch_route_on_intent(handle, route, hint);
+    return handle;
+}
+
 } // namespace detail
 
 element_handle
@@ -5,6 +5,9 @@
 
 namespace alia { namespace html {
 
+// (defined in route_data.hpp)
+struct prefetch_hint;
+
 // INPUTS
 
 struct input_handle : regular_element_handle<input_handle>
@@ -99,6 +102,26 @@ link(html::context ctx, Text text, Href href)
     return detail::link(ctx, signalize(text), signalize(href));
 }
 
+namespace detail {
+element_handle
+link(
+    html::context ctx,
+    readable<std::string> text,
+    readable<std::string> href,
+    prefetch_hint const& hint);
+}
+
+// link with an href and a prefetch hint - If the href is a hash route (e.g.,
+// "#/users/1"), the data declared for that route (see route_data.hpp) is
+// prefetched when the user shows an intent to follow the link. (Include
+// route_data.hpp to construct the hint.)
+template<class Text, class Href>
+element_handle
+link(html::context ctx, Text text, Href href, prefetch_hint const& hint)
+{
+    return detail::link(ctx, signalize(text), signalize(href), hint);
+}
+
 // CHECKBOX
 
 element_handle
@@ -0,0 +1,223 @@
+#include <alia/html/wire.hpp>
+
+#include <memory>
+
+namespace alia { namespace html {
+
+wire_table::wire_table(
+    char const* message, std::uint32_t message_size, std::uint32_t offset)
+{
+    // Offset 0 holds the root offset, so it can't be a table.
+    if (offset == 0 || std::uint64_t(offset) + 8 > message_size)
+        return;
+    auto field_count
+        = detail::load_wire_scalar<std::uint32_t>(message + offset);
+    if (std::uint64_t(offset) + 8 + std::uint64_t(field_count) * 8
+        > message_size)
+    {
+        return;
+    }
+    message_ = message;
+    message_size_ = message_size;
+    offset_ = offset;
+    field_count_ = field_count;
+}
+
+bool
+wire_table::get_range(
+    unsigned field,
+    std::uint32_t element_size,
+    std::uint32_t* offset,
+    std::uint32_t* count) const
+{
+    char const* slot = get_slot(field);
+    if (!slot)
+        return false;
+    *offset = detail::load_wire_scalar<std::uint32_t>(slot);
+    *count = detail::load_wire_scalar<std::uint32_t>(slot + 4);
+    return std::uint64_t(*offset) + std::uint64_t(*count) * element_size
+           <= message_size_;
+}
+
+wire_builder::wire_builder()
+{
+    // Reserve space for the root offset.
+    buffer_.resize(4);
+}
+
+std::uint32_t
+wire_builder::allocate(std::size_t size, std::size_t alignment)
+{
+    std::size_t offset = (buffer_.size() + alignment - 1) & ~(alignment - 1);
+    if (offset + size > 0xffffffff)
+        throw exception("wire message is too large");
+    buffer_.resize(offset + size);
+    return std::uint32_t(offset);
+}
+
+std::uint32_t
+wire_builder::add_table(unsigned field_count)
+{
+    auto offset = allocate(8 + std::size_t(field_count) * 8, 8);
+    detail::store_wire_scalar<std::uint32_t>(
+        buffer_.data() + offset, field_count);
+    return offset;
+}
+
+void
+wire_builder::set_string_at(std::uint32_t position, std::string_view value)
+{
+    auto offset = allocate(value.size(), 1);
+    if (!value.empty())
+        std::memcpy(buffer_.data() + offset, value.data(), value.size());
+    char* slot = buffer_.data() + position;
+    detail::store_wire_scalar<std::uint32_t>(slot, offset);
+    detail::store_wire_scalar<std::uint32_t>(
+        slot + 4, std::uint32_t(value.size()));
+}
+
+void
+wire_builder::set_string(
+    std::uint32_t table, unsigned field, std::string_view value)
+{
+    set_string_at(
+        std::uint32_t(get_slot(table, field) - buffer_.data()), value);
+}
+
+std::uint32_t
+wire_builder::add_array(
+    std::uint32_t table,
+    unsigned field,
+    std::uint32_t element_size,
+    std::uint32_t count)
+{
+    auto offset = allocate(
+        std::size_t(element_size) * count,
+        element_size < 8 ? element_size : 8);
+    char* slot = get_slot(table, field);
+    detail::store_wire_scalar<std::uint32_t>(slot, offset);
+    detail::store_wire_scalar<std::uint32_t>(slot + 4, count);
+    return offset;
+}
+
+void
+wire_builder::set_table_vector(
+    std::uint32_t table,
+    unsigned field,
+    std::vector<std::uint32_t> const& tables)
+{
+    auto offset = add_array(table, field, 4, std::uint32_t(tables.size()));
+    for (std::size_t i = 0; i != tables.size(); ++i)
+    {
+        detail::store_wire_scalar<std::uint32_t>(
+            buffer_.data() + offset + i * 4, tables[i]);
+    }
+}
+
+void
+wire_builder::set_table(
+    std::uint32_t table, unsigned field, std::uint32_t child)
+{
+    detail::store_wire_scalar<std::uint32_t>(get_slot(table, field), child);
+}
+
+blob
+wire_builder::finish(std::uint32_t root)
+{
+    detail::store_wire_scalar<std::uint32_t>(buffer_.data(), root);
+    auto storage = std::make_shared<std::vector<char>>(std::move(buffer_));
+    buffer_.clear();
+    buffer_.resize(4);
+    return blob{storage->data(), storage->size(), storage};
+}
+
+namespace {
+
+char const base64_alphabet[]
+    = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+int
+decode_base64_char(char c)
+{
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+        return c - '0' + 52;
+    if (c == '+')
+        return 62;
+    if (c == '/')
+        return 63;
+    return -1;
+}
+
+} // namespace
+
+std::string
+wire_to_storage_string(blob const& message)
+{
+    auto const* data = reinterpret_cast<unsigned char const*>(message.data);
+    std::string text;
+    text.reserve((message.size + 2) / 3 * 4);
+    std::uint64_t i = 0;
+    for (; i + 3 <= message.size; i += 3)
+    {
+        std::uint32_t n = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        text += base64_alphabet[(n >> 18) & 63];
+        text += base64_alphabet[(n >> 12) & 63];
+        text += base64_alphabet[(n >> 6) & 63];
+        text += base64_alphabet[n & 63];
+    }
+    if (i < message.size)
+    {
+        std::uint32_t n = data[i] << 16;
+        if (i + 1 < message.size)
+            n |= data[i + 1] << 8;
+        text += base64_alphabet[(n >> 18) & 63];
+        text += base64_alphabet[(n >> 12) & 63];
+        text += i + 1 < message.size ? base64_alphabet[(n >> 6) & 63] : '=';
+        text += '=';
+    }
+    return text;
+}
+
+blob
+wire_from_storage_string(std::string const& text)
+{
+    if (text.size() % 4 != 0)
+        return blob();
+    auto storage = std::make_shared<std::vector<char>>();
+    storage->reserve(text.size() / 4 * 3);
+    for (std::size_t i = 0; i != text.size(); i += 4)
+    {
+        std::uint32_t n = 0;
+        int padding = 0;
+        for (std::size_t j = 0; j != 4; ++j)
+        {
+            char c = text[i + j];
+            int value;
+            // Padding is only allowed in the last two positions of the last
+            // group.
+            if (c == '=' && i + 4 == text.size() && j >= 2
+                && (j == 3 || text[i + 3] == '='))
+            {
+                value = 0;
+                ++padding;
+            }
+            else if ((value = decode_base64_char(c)) < 0 || padding != 0)
+            {
+                return blob();
+            }
+            n = (n << 6) | std::uint32_t(value);
+        }
+        storage->push_back(char(n >> 16));
+        if (padding < 2)
+            storage->push_back(char((n >> 8) & 0xff));
+        if (padding < 1)
+            storage->push_back(char(n & 0xff));
+    }
+    return blob{storage->data(), storage->size(), storage};
+}
+
+}} // namespace alia::html
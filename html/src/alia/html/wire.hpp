@@ -0,0 +1,455 @@
+#ifndef ALIA_HTML_WIRE_HPP
+#define ALIA_HTML_WIRE_HPP
+
+#include <alia/html/fetch.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace alia { namespace html {
+
+// BINARY WIRE FORMAT
+//
+// The wire format is a schema-driven binary format that's read in place.
+// Readers are views directly over the memory of a blob (e.g., the body of an
+// http_response), so there's no parsing step and reading allocates nothing.
+//
+// Schemas are written in a small IDL:
+//
+//   table todo_item {
+//       completed: bool;
+//       title: string;
+//       id: int32;
+//   }
+//
+//   table app_state {
+//       todos: [todo_item];
+//       next_id: int32;
+//   }
+//
+// scripts/generate-wire-accessors.py turns a schema into a header with a
+// reader (e.g., todo_item_reader) and a builder (todo_item_builder) for each
+// table. Field types can be bool, (u)int8/16/32/64, float32, float64, string,
+// another table or a vector ([T]) of any of those.
+//
+// Fields can be added to the end of a table without breaking old messages or
+// old readers. (Missing fields read as their defaults.)
+//
+// LAYOUT
+//
+// All integers are little-endian, and all offsets are relative to the start
+// of the message.
+//
+// - The message starts with the (32-bit) offset of the root table.
+//
+// - A table is a 32-bit field count, 32 bits of padding, and then an 8-byte
+//   slot for each field.
+//
+// - Scalars are stored directly in their slots.
+//
+// - Strings and vectors are stored elsewhere in the message, and their slots
+//   hold their 32-bit offset and then their 32-bit length. Vectors of scalars
+//   are packed arrays. Vectors of strings are arrays of 8-byte (offset,
+//   length) pairs. Vectors of tables are arrays of 32-bit table offsets.
+//
+// - The slot of a table field holds the table's 32-bit offset. (An offset of
+//   0 means the field is absent.)
+//
+// Readers check all offsets and lengths against the size of the message, so
+// malformed messages just read as missing fields.
+//
+
+namespace detail {
+
+template<class T>
+T
+load_wire_scalar(char const* p)
+{
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+template<>
+inline bool
+load_wire_scalar<bool>(char const* p)
+{
+    return *p != 0;
+}
+
+template<class T>
+void
+store_wire_scalar(char* p, T value)
+{
+    std::memcpy(p, &value, sizeof(T));
+}
+
+template<>
+inline void
+store_wire_scalar<bool>(char* p, bool value)
+{
+    *p = value ? 1 : 0;
+}
+
+template<class T>
+constexpr std::uint32_t wire_scalar_size = std::is_same_v<T, bool>
+                                               ? 1
+                                               : std::uint32_t(sizeof(T));
+
+} // namespace detail
+
+struct wire_table;
+
+// wire_vector<T> is a view of a vector within a message.
+// T can be a scalar type, std::string_view or a table reader type.
+template<class T>
+struct wire_vector
+{
+    wire_vector()
+    {
+    }
+
+    wire_vector(
+        char const* message,
+        std::uint32_t message_size,
+        std::uint32_t offset,
+        std::uint32_t count)
+        : message_(message),
+          message_size_(message_size),
+          offset_(offset),
+          count_(count)
+    {
+    }
+
+    std::size_t
+    size() const
+    {
+        return count_;
+    }
+
+    bool
+    empty() const
+    {
+        return count_ == 0;
+    }
+
+    T
+    operator[](std::size_t index) const;
+
+ private:
+    char const* message_ = nullptr;
+    std::uint32_t message_size_ = 0;
+    std::uint32_t offset_ = 0;
+    std::uint32_t count_ = 0;
+};
+
+namespace detail {
+
+template<class T, class = void>
+struct wire_element
+{
+    static constexpr std::uint32_t size = wire_scalar_size<T>;
+
+    static T
+    read(char const* message, std::uint32_t, std::uint32_t offset)
+    {
+        return load_wire_scalar<T>(message + offset);
+    }
+};
+
+template<>
+struct wire_element<std::string_view>
+{
+    static constexpr std::uint32_t size = 8;
+
+    static std::string_view
+    read(char const* message, std::uint32_t message_size, std::uint32_t offset)
+    {
+        auto string_offset = load_wire_scalar<std::uint32_t>(message + offset);
+        auto length = load_wire_scalar<std::uint32_t>(message + offset + 4);
+        if (std::uint64_t(string_offset) + length > message_size)
+            return std::string_view();
+        return std::string_view(message + string_offset, length);
+    }
+};
+
+template<class T>
+struct wire_element<T, std::enable_if_t<std::is_base_of_v<wire_table, T>>>
+{
+    static constexpr std::uint32_t size = 4;
+
+    static T
+    read(char const* message, std::uint32_t message_size, std::uint32_t offset)
+    {
+        return T(
+            message,
+            message_size,
+            load_wire_scalar<std::uint32_t>(message + offset));
+    }
+};
+
+} // namespace detail
+
+template<class T>
+T
+wire_vector<T>::operator[](std::size_t index) const
+{
+    return detail::wire_element<T>::read(
+        message_,
+        message_size_,
+        offset_ + std::uint32_t(index) * detail::wire_element<T>::size);
+}
+
+// wire_table is the base of all table readers. (The generated readers just
+// add named accessors.)
+struct wire_table
+{
+    wire_table()
+    {
+    }
+
+    wire_table(
+        char const* message, std::uint32_t message_size, std::uint32_t offset);
+
+    // Does this refer to an actual table?
+    bool
+    exists() const
+    {
+        return message_ != nullptr;
+    }
+
+    // the number of fields in the table (as it was written)
+    std::uint32_t
+    field_count() const
+    {
+        return field_count_;
+    }
+
+    template<class T>
+    T
+    read_scalar(unsigned field, T default_value = T()) const
+    {
+        char const* slot = get_slot(field);
+        return slot ? detail::load_wire_scalar<T>(slot) : default_value;
+    }
+
+    std::string_view
+    read_string(unsigned field) const
+    {
+        char const* slot = get_slot(field);
+        return slot ? detail::wire_element<std::string_view>::read(
+                   message_, message_size_, std::uint32_t(slot - message_))
+                    : std::string_view();
+    }
+
+    template<class T>
+    wire_vector<T>
+    read_vector(unsigned field) const
+    {
+        std::uint32_t offset, count;
+        if (!get_range(field, detail::wire_element<T>::size, &offset, &count))
+            return wire_vector<T>();
+        return wire_vector<T>(message_, message_size_, offset, count);
+    }
+
+    template<class Table>
+    Table
+    read_table(unsigned field) const
+    {
+        char const* slot = get_slot(field);
+        return slot ? Table(
+                   message_,
+                   message_size_,
+                   detail::load_wire_scalar<std::uint32_t>(slot))
+                    : Table();
+    }
+
+ private:
+    char const*
+    get_slot(unsigned field) const
+    {
+        return field < field_count_ ? message_ + offset_ + 8 + field * 8
+                                    : nullptr;
+    }
+
+    // Get the offset and count of a string or vector field, checking that it
+    // actually fits within the message.
+    bool
+    get_range(
+        unsigned field,
+        std::uint32_t element_size,
+        std::uint32_t* offset,
+        std::uint32_t* count) const;
+
+    char const* message_ = nullptr;
+    std::uint32_t message_size_ = 0;
+    std::uint32_t offset_ = 0;
+    std::uint32_t field_count_ = 0;
+};
+
+// Get a reader for the root table of a message.
+// The message must outlive the reader (and anything read from it).
+template<class Table>
+Table
+read_wire_root(blob const& message)
+{
+    if (message.size < 4 || message.size > 0xffffffff)
+        return Table();
+    return Table(
+        message.data,
+        std::uint32_t(message.size),
+        detail::load_wire_scalar<std::uint32_t>(message.data));
+}
+
+// A wire_message pairs a message with its root table type, so that it can be
+// passed around (e.g., as a signal value) without worrying about ownership.
+template<class Table>
+struct wire_message
+{
+    blob data;
+
+    Table
+    root() const
+    {
+        return read_wire_root<Table>(data);
+    }
+};
+
+// wire_builder builds messages. Tables and their contents can be added in
+// any order, but all references between them are by offset (since the
+// underlying buffer moves as it grows).
+struct wire_builder
+{
+    wire_builder();
+
+    // Add a table with the given number of fields and return its offset.
+    std::uint32_t
+    add_table(unsigned field_count);
+
+    template<class T>
+    void
+    set_scalar(std::uint32_t table, unsigned field, T value)
+    {
+        detail::store_wire_scalar<T>(get_slot(table, field), value);
+    }
+
+    void
+    set_string(std::uint32_t table, unsigned field, std::string_view value);
+
+    template<class T>
+    void
+    set_vector(
+        std::uint32_t table, unsigned field, std::vector<T> const& values)
+    {
+        auto offset = add_array(
+            table,
+            field,
+            detail::wire_scalar_size<T>,
+            std::uint32_t(values.size()));
+        for (std::size_t i = 0; i != values.size(); ++i)
+        {
+            detail::store_wire_scalar<T>(
+                buffer_.data() + offset + i * detail::wire_scalar_size<T>,
+                values[i]);
+        }
+    }
+
+    template<class Strings>
+    void
+    set_string_vector(
+        std::uint32_t table, unsigned field, Strings const& strings)
+    {
+        auto offset
+            = add_array(table, field, 8, std::uint32_t(std::size(strings)));
+        std::uint32_t i = 0;
+        for (auto const& string : strings)
+            set_string_at(offset + 8 * i++, std::string_view(string));
+    }
+
+    // Set a vector of tables, given their offsets.
+    void
+    set_table_vector(
+        std::uint32_t table,
+        unsigned field,
+        std::vector<std::uint32_t> const& tables);
+
+    void
+    set_table(std::uint32_t table, unsigned field, std::uint32_t child);
+
+    // Finish the message (with the given root table) and return it.
+    // The builder is left empty.
+    blob
+    finish(std::uint32_t root);
+
+ private:
+    char*
+    get_slot(std::uint32_t table, unsigned field)
+    {
+        return buffer_.data() + table + 8 + field * 8;
+    }
+
+    // Append an array and point the given field at it. Returns its offset.
+    std::uint32_t
+    add_array(
+        std::uint32_t table,
+        unsigned field,
+        std::uint32_t element_size,
+        std::uint32_t count);
+
+    // Append a string and store its offset and length at 'position'.
+    void
+    set_string_at(std::uint32_t position, std::string_view value);
+
+    std::uint32_t
+    allocate(std::size_t size, std::size_t alignment);
+
+    std::vector<char> buffer_;
+};
+
+// STORAGE
+//
+// Web Storage only holds text, so messages are stored as base64.
+
+std::string
+wire_to_storage_string(blob const& message);
+
+// This returns an empty blob if the string isn't valid base64.
+blob
+wire_from_storage_string(std::string const& text);
+
+// SIGNALS
+
+// Get a signal carrying the (wire format) body of a response as a message.
+template<class Table, class Response>
+auto
+read_wire_response(alia::context ctx, Response response)
+{
+    return apply(
+        ctx,
+        [](http_response const& response) {
+            return wire_message<Table>{response.body};
+        },
+        std::move(response));
+}
+
+// Get a signal carrying the message stored in a text signal (e.g., a
+// storage_signal).
+template<class Table, class Text>
+auto
+read_wire_storage(alia::context ctx, Text text)
+{
+    return apply(
+        ctx,
+        [](std::string const& text) {
+            return wire_message<Table>{wire_from_storage_string(text)};
+        },
+        std::move(text));
+}
+
+}} // namespace alia::html
+
+#endif
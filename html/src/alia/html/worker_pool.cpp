@@ -0,0 +1,122 @@
+#include <alia/html/worker_pool.hpp>
+
+#include <emscripten/emscripten.h>
+
+#include <memory>
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+#include <emscripten/threading.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace alia { namespace html {
+
+namespace {
+
+struct background_job
+{
+    std::function<void()> task;
+    std::function<void()> completion;
+};
+
+void
+complete_background_job(void* arg)
+{
+    std::unique_ptr<background_job> job(
+        reinterpret_cast<background_job*>(arg));
+    job->completion();
+}
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+
+struct worker_pool
+{
+    std::mutex mutex;
+    std::condition_variable jobs_available;
+    std::deque<background_job*> jobs;
+    unsigned worker_count = 0;
+};
+
+worker_pool the_pool;
+
+void
+run_worker()
+{
+    while (true)
+    {
+        background_job* job;
+        {
+            std::unique_lock<std::mutex> lock(the_pool.mutex);
+            the_pool.jobs_available.wait(
+                lock, [] { return !the_pool.jobs.empty(); });
+            job = the_pool.jobs.front();
+            the_pool.jobs.pop_front();
+        }
+        job->task();
+        job->task = nullptr;
+        emscripten_async_run_in_main_runtime_thread(
+            EM_FUNC_SIG_VI, complete_background_job, job);
+    }
+}
+
+// The workers are started lazily, since many apps never need them.
+void
+start_workers()
+{
+    // Leave a core for the main thread (and the browser).
+    unsigned hardware = std::thread::hardware_concurrency();
+    the_pool.worker_count
+        = std::clamp(hardware > 1 ? hardware - 1 : 1u, 1u, 4u);
+    for (unsigned i = 0; i != the_pool.worker_count; ++i)
+        std::thread(run_worker).detach();
+}
+
+#else
+
+void
+run_background_job(void* arg)
+{
+    auto* job = reinterpret_cast<background_job*>(arg);
+    job->task();
+    job->task = nullptr;
+    complete_background_job(job);
+}
+
+#endif
+
+} // namespace
+
+void
+run_in_background(
+    std::function<void()> task, std::function<void()> completion)
+{
+    auto* job = new background_job{std::move(task), std::move(completion)};
+#ifdef __EMSCRIPTEN_PTHREADS__
+    if (the_pool.worker_count == 0)
+        start_workers();
+    {
+        std::lock_guard<std::mutex> lock(the_pool.mutex);
+        the_pool.jobs.push_back(job);
+    }
+    the_pool.jobs_available.notify_one();
+#else
+    emscripten_async_call(run_background_job, job, 0);
+#endif
+}
+
+unsigned
+get_worker_count()
+{
+#ifdef __EMSCRIPTEN_PTHREADS__
+    return the_pool.worker_count;
+#else
+    return 0;
+#endif
+}
+
+}} // namespace alia::html
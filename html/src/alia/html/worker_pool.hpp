@@ -0,0 +1,39 @@
+#ifndef ALIA_HTML_WORKER_POOL_HPP
+#define ALIA_HTML_WORKER_POOL_HPP
+
+#include <functional>
+
+namespace alia { namespace html {
+
+// WORKER POOL
+//
+// When alia/HTML is built with pthreads (see ALIA_HTML_USE_PTHREADS in
+// CMakeLists.txt), background tasks run on a small pool of worker threads, so
+// CPU-heavy work (like decoding large responses) doesn't block input on the
+// main thread.
+//
+// Without pthreads, background tasks run on the main thread, but always
+// asynchronously (i.e., from the browser's event loop), so callers see the
+// same ordering either way.
+//
+
+// Run 'task' in the background. Once it's done, 'completion' is invoked on
+// the main thread.
+//
+// The task is destroyed (on its worker) before the completion is invoked. So
+// anything that must be released on the main thread (e.g., the blob of an
+// http_response, which may own an Emscripten fetch) should also be captured
+// by the completion.
+//
+void
+run_in_background(
+    std::function<void()> task, std::function<void()> completion);
+
+// the number of worker threads (0 if there are no pthreads or the pool hasn't
+// been started yet)
+unsigned
+get_worker_count();
+
+}} // namespace alia::html
+
+#endif